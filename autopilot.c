@@ -0,0 +1,494 @@
+/// Program: autopilot.c
+///----------------------
+/// Indexes falling missiles by column and predicted arrival for the
+/// autopilot shield. Each column keeps its missiles in a binary min-heap
+/// with every missile's position recorded, so a step moves one missile in
+/// O(log n). A segment tree over the columns holds each column's earliest
+/// arrival in three forms: as is, and offset by the column times the
+/// shield's move time in either direction, so the cost of reaching a
+/// missile on either side of the shield is a range minimum.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "autopilot.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define UNTRACKED	(-1)
+#define NOTHING	(INT64_MAX / 4)
+
+/// Column_S structure is one column's missiles, a heap by arrival
+
+typedef struct Column_S {
+
+	size_t *heap; ///< missile slots, earliest arrival first
+
+	size_t count; ///< slots in the heap
+
+	size_t room; ///< slots allocated
+
+} Column;
+
+/// Best_S structure is a minimum over a range of columns, one per view
+
+typedef struct Best_S {
+
+	int64_t value[3]; ///< the least arrival, arrival - column * move, arrival + column * move
+
+	int column[3]; ///< the column each minimum was found in
+
+} Best;
+
+enum { VIEW_UNDER, VIEW_LEFT, VIEW_RIGHT };
+
+struct Autopilot_S {
+
+	pthread_mutex_t mutex; ///< guards everything below; the missiles step on many threads
+
+	uint64_t now; ///< the time the shield decides at
+
+	uint64_t moveTime; ///< microseconds the shield takes to move one column
+
+	int columns; ///< columns in the world
+
+	size_t leaves; ///< columns rounded up to a power of two
+
+	Best *tree; ///< the segment tree, node 1 the root and leaf c at leaves + c
+
+	Column *lanes; ///< each column's heap
+
+	int *column; ///< each missile's column, UNTRACKED when not indexed
+
+	size_t *slot; ///< each missile's position in its column's heap
+
+	uint64_t *arrival; ///< each missile's predicted arrival
+
+	bool *conceded; ///< whether the shield gave up on each missile during its current fall
+
+	size_t concessions; ///< missiles conceded so far, each counted once per fall
+};
+
+/// Function: earlier
+///-------------------
+/// Orders two missiles by arrival, then by slot so ties are deterministic
+///
+/// @param pilot the index
+/// @param a the first slot
+/// @param b the second slot
+/// @return true if a comes before b
+
+static bool earlier(const Autopilot * pilot, size_t a, size_t b){
+	if (pilot->arrival[a] != pilot->arrival[b])
+		return pilot->arrival[a] < pilot->arrival[b];
+	return a < b;
+}
+
+/// Function: place
+///-----------------
+/// Puts a missile at a position in its column's heap
+///
+/// @param pilot the index
+/// @param lane the column's heap
+/// @param at the position
+/// @param id the missile's slot
+
+static void place(Autopilot * pilot, Column * lane, size_t at, size_t id){
+	lane->heap[at] = id;
+	pilot->slot[id] = at;
+}
+
+/// Function: siftUp
+///------------------
+/// Restores the heap above a missile that may now arrive earlier
+///
+/// @param pilot the index
+/// @param lane the column's heap
+/// @param at the missile's position
+
+static void siftUp(Autopilot * pilot, Column * lane, size_t at){
+	size_t id = lane->heap[at];
+	while (at > 0 && earlier(pilot, id, lane->heap[(at - 1) / 2]) == true){
+		place(pilot, lane, at, lane->heap[(at - 1) / 2]);
+		at = (at - 1) / 2;
+	}
+	place(pilot, lane, at, id);
+}
+
+/// Function: siftDown
+///--------------------
+/// Restores the heap below a missile that may now arrive later
+///
+/// @param pilot the index
+/// @param lane the column's heap
+/// @param at the missile's position
+
+static void siftDown(Autopilot * pilot, Column * lane, size_t at){
+	size_t id = lane->heap[at];
+	for (;;){
+		size_t child = 2 * at + 1;
+		if (child >= lane->count)
+			break;
+		if (child + 1 < lane->count && earlier(pilot, lane->heap[child + 1], lane->heap[child]) == true)
+			child++;
+		if (earlier(pilot, lane->heap[child], id) == false)
+			break;
+		place(pilot, lane, at, lane->heap[child]);
+		at = child;
+	}
+	place(pilot, lane, at, id);
+}
+
+/// Function: combine
+///-------------------
+/// Takes the lesser of two minimums in each view
+///
+/// @param a the first minimum
+/// @param b the second minimum
+/// @return the combined minimum
+
+static Best combine(const Best * a, const Best * b){
+	Best best = *a;
+	for (int view = 0; view < 3; view++){
+		if (b->value[view] < best.value[view]){
+			best.value[view] = b->value[view];
+			best.column[view] = b->column[view];
+		}
+	}
+	return best;
+}
+
+/// Function: refresh
+///-------------------
+/// Recomputes a column's leaf from its heap and the tree above it
+///
+/// @param pilot the index
+/// @param c the column
+
+static void refresh(Autopilot * pilot, int c){
+	Column * lane = &pilot->lanes[c];
+	size_t node = pilot->leaves + c;
+	Best * leaf = &pilot->tree[node];
+	if (lane->count == 0){
+		leaf->value[VIEW_UNDER] = leaf->value[VIEW_LEFT] = leaf->value[VIEW_RIGHT] = NOTHING;
+	} else {
+		int64_t at = (int64_t)pilot->arrival[lane->heap[0]];
+		int64_t offset = (int64_t)c * (int64_t)pilot->moveTime;
+		leaf->value[VIEW_UNDER] = at;
+		leaf->value[VIEW_LEFT] = at - offset;
+		leaf->value[VIEW_RIGHT] = at + offset;
+	}
+	leaf->column[VIEW_UNDER] = leaf->column[VIEW_LEFT] = leaf->column[VIEW_RIGHT] = c;
+	for (node /= 2; node > 0; node /= 2)
+		pilot->tree[node] = combine(&pilot->tree[2 * node], &pilot->tree[2 * node + 1]);
+}
+
+/// Function: query
+///-----------------
+/// Finds the minimums over a range of columns
+///
+/// @param pilot the index
+/// @param first the range's first column
+/// @param last the range's last column
+/// @return the minimums, NOTHING in each view if the range is empty
+
+static Best query(const Autopilot * pilot, int first, int last){
+	Best best = { { NOTHING, NOTHING, NOTHING }, { 0, 0, 0 } };
+	if (first < 0)
+		first = 0;
+	if (last >= pilot->columns)
+		last = pilot->columns - 1;
+	if (first > last)
+		return best;
+	size_t low = pilot->leaves + first, high = pilot->leaves + last + 1;
+	while (low < high){
+		if (low & 1)
+			best = combine(&best, &pilot->tree[low++]);
+		if (high & 1)
+			best = combine(&best, &pilot->tree[--high]);
+		low /= 2;
+		high /= 2;
+	}
+	return best;
+}
+
+/// Function: drop
+///----------------
+/// Takes an indexed missile out of its column's heap
+///
+/// @param pilot the index
+/// @param id the missile's slot
+
+static void drop(Autopilot * pilot, size_t id){
+	int c = pilot->column[id];
+	Column * lane = &pilot->lanes[c];
+	size_t at = pilot->slot[id];
+	size_t last = lane->heap[--lane->count];
+	pilot->column[id] = UNTRACKED;
+	if (last != id){
+		place(pilot, lane, at, last);
+		siftUp(pilot, lane, at);
+		siftDown(pilot, lane, pilot->slot[last]);
+	}
+	if (at == 0 || pilot->slot[last] == 0)
+		refresh(pilot, c);
+}
+
+/// Function: createAutopilot
+///---------------------------
+/// Creates an empty index
+///
+/// @param capacity the number of missile slots
+/// @param columns the number of columns in the world
+/// @param moveTime microseconds the shield takes to move one column
+/// @return Autopilot pointer to the dynamically allocated index
+
+Autopilot * createAutopilot(size_t capacity, int columns, uint64_t moveTime){
+	assert(columns > 0);
+	Autopilot * new = malloc(sizeof(struct Autopilot_S));
+	if (new == NULL)
+		return NULL;
+	new->leaves = 1;
+	while (new->leaves < (size_t)columns)
+		new->leaves *= 2;
+	new->tree = malloc(2 * new->leaves * sizeof(Best));
+	new->lanes = calloc(columns, sizeof(Column));
+	new->column = malloc(capacity * sizeof(int));
+	new->slot = malloc(capacity * sizeof(size_t));
+	new->arrival = malloc(capacity * sizeof(uint64_t));
+	new->conceded = calloc(capacity, sizeof(bool));
+	if (new->tree == NULL || new->lanes == NULL || (capacity > 0 && (new->column == NULL ||
+			new->slot == NULL || new->arrival == NULL || new->conceded == NULL))){
+		free(new->tree);
+		free(new->lanes);
+		free(new->column);
+		free(new->slot);
+		free(new->arrival);
+		free(new->conceded);
+		free(new);
+		return NULL;
+	}
+	for (size_t node = 0; node < 2 * new->leaves; node++){
+		for (int view = 0; view < 3; view++){
+			new->tree[node].value[view] = NOTHING;
+			new->tree[node].column[view] = 0;
+		}
+	}
+	for (size_t id = 0; id < capacity; id++)
+		new->column[id] = UNTRACKED;
+	pthread_mutex_init(&new->mutex, NULL);
+	new->now = 0;
+	new->moveTime = moveTime;
+	new->columns = columns;
+	new->concessions = 0;
+	return new;
+}
+
+/// Function: destroyAutopilot
+///----------------------------
+/// De-allocates an index
+///
+/// @param pilot the object to be de-allocated
+
+void destroyAutopilot(Autopilot * pilot){
+	assert(pilot != NULL);
+	for (int c = 0; c < pilot->columns; c++)
+		free(pilot->lanes[c].heap);
+	pthread_mutex_destroy(&pilot->mutex);
+	free(pilot->tree);
+	free(pilot->lanes);
+	free(pilot->column);
+	free(pilot->slot);
+	free(pilot->arrival);
+	free(pilot->conceded);
+	free(pilot);
+}
+
+/// Function: autopilotTime
+///-------------------------
+/// Sets the time decisions are made at
+///
+/// @param pilot the index being updated
+/// @param now the current time in microseconds
+
+void autopilotTime(Autopilot * pilot, uint64_t now){
+	assert(pilot != NULL);
+	pthread_mutex_lock(&pilot->mutex);
+	pilot->now = now;
+	pthread_mutex_unlock(&pilot->mutex);
+}
+
+/// Function: track
+///-----------------
+/// Indexes a falling missile, or moves it if it is already indexed. A
+/// conceded missile comes back in, since its new arrival may be in reach.
+/// A missile the heap has no room for is left out. The mutex must be held.
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+/// @param column the missile's column
+/// @param arrival when the missile is expected to reach the shield's row
+
+static void track(Autopilot * pilot, size_t id, int column, uint64_t arrival){
+	assert(column >= 0 && column < pilot->columns);
+	if (pilot->column[id] != UNTRACKED && pilot->column[id] != column)
+		drop(pilot, id);
+	Column * lane = &pilot->lanes[column];
+	uint64_t before = pilot->arrival[id];
+	pilot->arrival[id] = arrival;
+	if (pilot->column[id] == UNTRACKED){
+		if (lane->count == lane->room){
+			size_t room = lane->room > 0 ? 2 * lane->room : 8;
+			size_t * heap = realloc(lane->heap, room * sizeof(size_t));
+			if (heap != NULL){
+				lane->heap = heap;
+				lane->room = room;
+			}
+		}
+		if (lane->count < lane->room){
+			pilot->column[id] = column;
+			place(pilot, lane, lane->count++, id);
+			siftUp(pilot, lane, lane->count - 1);
+		}
+	} else if (pilot->arrival[id] < before)
+		siftUp(pilot, lane, pilot->slot[id]);
+	else
+		siftDown(pilot, lane, pilot->slot[id]);
+	refresh(pilot, column);
+}
+
+/// Function: forget
+///------------------
+/// Drops a missile that can no longer reach the shield's row, and lets its
+/// slot be indexed again once it respawns. The mutex must be held.
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+
+static void forget(Autopilot * pilot, size_t id){
+	if (pilot->column[id] != UNTRACKED)
+		drop(pilot, id);
+	pilot->conceded[id] = false;
+}
+
+/// Function: autopilotTrack
+///--------------------------
+/// Indexes a falling missile, or moves it if it is already indexed
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+/// @param column the missile's column
+/// @param arrival when the missile is expected to reach the shield's row
+
+void autopilotTrack(Autopilot * pilot, size_t id, int column, uint64_t arrival){
+	assert(pilot != NULL);
+	pthread_mutex_lock(&pilot->mutex);
+	track(pilot, id, column, arrival);
+	pthread_mutex_unlock(&pilot->mutex);
+}
+
+/// Function: autopilotForget
+///---------------------------
+/// Drops a missile that can no longer reach the shield's row
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+
+void autopilotForget(Autopilot * pilot, size_t id){
+	assert(pilot != NULL);
+	pthread_mutex_lock(&pilot->mutex);
+	forget(pilot, id);
+	pthread_mutex_unlock(&pilot->mutex);
+}
+
+/// Function: autopilotUpdate
+///---------------------------
+/// Tracks or forgets a batch of missiles under one hold of the mutex
+///
+/// @param pilot the index being updated
+/// @param ids the missiles' slots
+/// @param columns each missile's column, AUTOPILOT_FORGET to drop it
+/// @param arrivals when each tracked missile is expected to reach the shield's row
+/// @param count number of missiles
+
+void autopilotUpdate(Autopilot * pilot, const size_t * ids, const int * columns, const uint64_t * arrivals, size_t count){
+	assert(pilot != NULL);
+	pthread_mutex_lock(&pilot->mutex);
+	for (size_t i = 0; i < count; i++){
+		if (columns[i] == AUTOPILOT_FORGET)
+			forget(pilot, ids[i]);
+		else
+			track(pilot, ids[i], columns[i], arrivals[i]);
+	}
+	pthread_mutex_unlock(&pilot->mutex);
+}
+
+/// Function: autopilotTarget
+///---------------------------
+/// Picks where the shield should head. Each column's soonest missile costs
+/// its arrival plus the time to bring the shield over it; the cheapest one
+/// the shield can still reach in time is the target. A missile out of reach
+/// is conceded until it next steps: its arrival is predicted afresh then,
+/// and a slow fall can bring it back in reach. Each missile is counted as
+/// conceded once per fall.
+///
+/// @param pilot the index being queried
+/// @param left the shield's left-most column
+/// @param width the shield's width
+/// @return the left-most column the shield should move toward
+
+int autopilotTarget(Autopilot * pilot, int left, int width){
+	assert(pilot != NULL && width > 0);
+	int right = left + width - 1;
+	int64_t move = (int64_t)pilot->moveTime;
+	int target = left;
+	pthread_mutex_lock(&pilot->mutex);
+	for (;;){
+		Best under = query(pilot, left, right);
+		Best before = query(pilot, 0, left - 1);
+		Best after = query(pilot, right + 1, pilot->columns - 1);
+		int64_t cost = under.value[VIEW_UNDER];
+		int c = under.column[VIEW_UNDER];
+		if (before.value[VIEW_LEFT] != NOTHING && before.value[VIEW_LEFT] + left * move < cost){
+			cost = before.value[VIEW_LEFT] + left * move;
+			c = before.column[VIEW_LEFT];
+		}
+		if (after.value[VIEW_RIGHT] != NOTHING && after.value[VIEW_RIGHT] - right * move < cost){
+			cost = after.value[VIEW_RIGHT] - right * move;
+			c = after.column[VIEW_RIGHT];
+		}
+		if (cost >= NOTHING)
+			break; // nothing in flight
+		int64_t distance = c < left ? left - c : c > right ? c - right : 0;
+		Column * lane = &pilot->lanes[c];
+		int64_t slack = (int64_t)pilot->arrival[lane->heap[0]] - (int64_t)pilot->now - distance * move;
+		if (slack >= 0){
+			if (distance > 0)
+				target = c - width / 2 < 0 ? 0 : c - width / 2;
+			break;
+		}
+		size_t id = lane->heap[0];
+		drop(pilot, id);
+		if (pilot->conceded[id] == false)
+			pilot->concessions++;
+		pilot->conceded[id] = true;
+	}
+	pthread_mutex_unlock(&pilot->mutex);
+	return target;
+}
+
+/// Function: autopilotConceded
+///-----------------------------
+/// The number of missiles conceded so far
+///
+/// @param pilot the index being read
+/// @return the number of missiles conceded
+
+size_t autopilotConceded(Autopilot * pilot){
+	assert(pilot != NULL);
+	pthread_mutex_lock(&pilot->mutex);
+	size_t conceded = pilot->concessions;
+	pthread_mutex_unlock(&pilot->mutex);
+	return conceded;
+}
@@ -0,0 +1,101 @@
+/// autopilot.h - header file for the autopilot shield's missile index
+///
+/// @author Brennan Reed
+///
+/// This is the interface for steering the shield without a player. Every
+/// falling missile is indexed by its column and its predicted arrival at
+/// the shield's row: each column keeps a heap of its missiles, and a
+/// segment tree over the columns keeps each column's earliest arrival. A
+/// decision is a few range queries on the tree, so its cost grows with the
+/// log of the columns, not with the missiles in flight.
+
+#ifndef _AUTOPILOT_H
+#define _AUTOPILOT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// AUTOPILOT_PERIOD is the microseconds between two moves of the shield
+
+#define AUTOPILOT_PERIOD 50000
+
+/// AUTOPILOT_FORGET in place of a column has autopilotUpdate drop a missile
+
+#define AUTOPILOT_FORGET (-1)
+
+/// Autopilot_S structure is the missile index. The definition is private
+/// to autopilot.c.
+
+typedef struct Autopilot_S Autopilot;
+
+/// createAutopilot - Create an empty index.
+///
+/// @param capacity the number of missile slots
+/// @param columns the number of columns in the world
+/// @param moveTime microseconds the shield takes to move one column
+/// @return Autopilot pointer to a dynamically allocated Autopilot object
+
+Autopilot * createAutopilot( size_t capacity, int columns, uint64_t moveTime );
+
+/// destroyAutopilot - Destroy all dynamically allocated storage for an index.
+///
+/// @param pilot the object to be de-allocated
+
+void destroyAutopilot( Autopilot *pilot );
+
+/// autopilotTime - Sets the time decisions are made at, the time a
+/// missile's slack to arrive in is counted from.
+///
+/// @param pilot the index being updated
+/// @param now the current time in microseconds
+
+void autopilotTime( Autopilot *pilot, uint64_t now );
+
+/// autopilotTrack - Indexes a falling missile, or moves it if it is indexed.
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+/// @param column the missile's column
+/// @param arrival the virtual time the missile is expected to reach the shield's row
+
+void autopilotTrack( Autopilot *pilot, size_t id, int column, uint64_t arrival );
+
+/// autopilotForget - Drops a missile that can no longer reach the shield's row.
+///
+/// @param pilot the index being updated
+/// @param id the missile's slot
+
+void autopilotForget( Autopilot *pilot, size_t id );
+
+/// autopilotUpdate - Tracks or forgets a batch of missiles under one hold
+/// of the index's lock, so a worker stepping many missiles takes it once.
+///
+/// @param pilot the index being updated
+/// @param ids the missiles' slots
+/// @param columns each missile's column, AUTOPILOT_FORGET to drop it
+/// @param arrivals the virtual time each tracked missile is expected to reach the shield's row
+/// @param count number of missiles
+
+void autopilotUpdate( Autopilot *pilot, const size_t *ids, const int *columns,
+		const uint64_t *arrivals, size_t count );
+
+/// autopilotTarget - Picks where the shield should head: under the missile
+/// that lands soonest once the time to get there is counted. A missile the
+/// shield can no longer reach in time is conceded until it is next tracked.
+///
+/// @param pilot the index being queried
+/// @param left the shield's left-most column
+/// @param width the shield's width
+/// @return the left-most column the shield should move toward
+
+int autopilotTarget( Autopilot *pilot, int left, int width );
+
+/// autopilotConceded - The number of missiles conceded so far, each counted
+/// once per fall however often it comes back in reach.
+///
+/// @param pilot the index being read
+/// @return the number of missiles conceded
+
+size_t autopilotConceded( Autopilot *pilot );
+
+#endif
@@ -0,0 +1,79 @@
+/// Program: batch.c
+///------------------
+/// Vectorized missile step. The cells below each missile are gathered
+/// from the collision grid, then the hit rules of advance() are applied
+/// as branch-free mask arithmetic on GCC vector types, so the compiler
+/// can use whatever SIMD width the target has.
+///
+/// @author Brennan Reed
+
+#include "batch.h"
+#include <string.h>
+#include <stdint.h>
+
+/// Lanes is BATCH_LANES 32-bit integers; comparisons yield -1 or 0 per lane
+typedef int32_t Lanes __attribute__((vector_size(BATCH_LANES * sizeof(int32_t))));
+
+/// Function: classify
+///--------------------
+/// Works out one step for BATCH_LANES missiles
+///
+/// @param grid the collision grid
+/// @param ground the ground row
+/// @param shieldRow the shield's row
+/// @param height each missile's current row
+/// @param column each missile's column
+/// @param nextHeight where each missile's next row is stored
+/// @param hits where what each missile struck is stored
+
+static void classify(const Occupancy * grid, int ground, int shieldRow, const Lanes * height,
+		const Lanes * column, Lanes * nextHeight, Lanes * hits){
+	Lanes h = *height, c = *column; // passed by address, so no AVX register ABI is assumed
+	Lanes below = h + 1;
+	Lanes next;
+	for (int i = 0; i < BATCH_LANES; i++){ // gathers the cell below each missile
+		int row = below[i], col = c[i];
+		next[i] = (row < 0 || row >= grid->rows || col < 0 || col >= grid->cols) ?
+				CELL_EMPTY : grid->cells[row * grid->cols + col];
+	}
+	Lanes building = next == CELL_BUILDING;
+	Lanes shield = next == CELL_SHIELD;
+	Lanes debris = next == CELL_DEBRIS;
+	Lanes landing = (h + 2 == shieldRow) | (below == ground); // debris on the shield or the ground
+	// one row down, none onto the shield, two through debris inside a building
+	*nextHeight = h + 1 + shield - (debris & ~landing);
+	Lanes grounded = *nextHeight >= ground; // the kinds below never overlap
+	building &= ~grounded; // the ground row is built like a roof
+	grounded &= ~(shield | debris);
+	*hits = (building & HIT_BUILDING) | (shield & HIT_SHIELD) | (debris & HIT_DEBRIS) | (grounded & HIT_GROUND);
+}
+
+/// Function: batchClassify
+///-------------------------
+/// Works out one step for every missile in a batch; the tail that does not
+/// fill a vector is padded with missiles far off the grid
+
+void batchClassify(const Occupancy * grid, int ground, int shieldRow, const int * height,
+		const int * column, size_t count, int * nextHeight, int * hits){
+	Lanes h, c, next, hit;
+	size_t i = 0;
+	for (; i + BATCH_LANES <= count; i += BATCH_LANES){
+		memcpy(&h, height + i, sizeof(Lanes));
+		memcpy(&c, column + i, sizeof(Lanes));
+		classify(grid, ground, shieldRow, &h, &c, &next, &hit);
+		memcpy(nextHeight + i, &next, sizeof(Lanes));
+		memcpy(hits + i, &hit, sizeof(Lanes));
+	}
+	if (i < count){
+		size_t rest = count - i;
+		for (int lane = 0; lane < BATCH_LANES; lane++){
+			h[lane] = -2; // off the grid, and never mistaken for the shield or ground rows
+			c[lane] = -1;
+		}
+		memcpy(&h, height + i, rest * sizeof(int));
+		memcpy(&c, column + i, rest * sizeof(int));
+		classify(grid, ground, shieldRow, &h, &c, &next, &hit);
+		memcpy(nextHeight + i, &next, rest * sizeof(int));
+		memcpy(hits + i, &hit, rest * sizeof(int));
+	}
+}
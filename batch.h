@@ -0,0 +1,44 @@
+/// batch.h - header file for the vectorized missile step
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the kernel that works out a whole batch of
+/// missile steps at once. It reads contiguous height and column arrays and
+/// computes each missile's next row and what, if anything, it hits, eight missiles
+/// per vector operation, using the same rules as the scalar advance().
+
+#ifndef _BATCH_H
+#define _BATCH_H
+#include <stddef.h>
+#include "occupancy.h"
+
+/// BATCH_LANES is the number of missiles each vector operation covers
+
+#define BATCH_LANES 8
+
+/// BATCH_SIZE is the most missiles advanceBatch works out under one set of locks
+
+#define BATCH_SIZE 256
+
+/// BATCH_DENSITY is the fewest missiles per stripe locked a chunk needs for
+/// advanceBatch to step it with the kernel; sparser chunks take nearly a
+/// lock per missile either way, and the scalar step is cheaper
+
+#define BATCH_DENSITY 2
+
+/// batchClassify - Works out one step for every missile in a batch.
+///
+/// @param grid the collision grid, read but not changed
+/// @param ground the ground row
+/// @param shieldRow the shield's row
+/// @param height each missile's current row
+/// @param column each missile's column
+/// @param count number of missiles in the batch
+/// @param nextHeight where each missile's row after the step is stored
+/// @param hits where what each missile struck is stored, as a Hit; HIT_NONE
+///        if it is still falling
+
+void batchClassify( const Occupancy *grid, int ground, int shieldRow, const int *height,
+        const int *column, size_t count, int *nextHeight, int *hits );
+
+#endif
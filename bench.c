@@ -0,0 +1,600 @@
+/// Program: bench.c
+///------------------
+/// Measures the game engine with no terminal attached. Every combination
+/// of missile count, thread count and city width is run for a fixed number
+/// of missile steps and reported as one CSV row. With -v, the batched
+/// missile step is checked against the scalar one and both are timed, and
+/// an endless attack is played with each thread count and compared, as
+/// well as two at once in separate games.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include "threads.h"
+#include "clock.h"
+#include "occupancy.h"
+#include "plock.h"
+#include "pool.h"
+#include "rng.h"
+#include "wheel.h"
+
+#define BENCH_ROWS	24
+#define DEFAULT_STEPS	200000
+#define DEFAULT_MISSILES	"16,256,4096"
+#define DEFAULT_THREADS	"1,2,4,8"
+#define DEFAULT_WIDTHS	"80,1000,100000"
+#define MAX_SWEEP	16
+#define BURROW_ROOF	15
+#define BURROW_MISSILES	3
+#define ENDLESS_WIDTH	200
+#define ENDLESS_MISSILES	1024
+#define ENDLESS_INTERVAL	10000
+#define ENDLESS_TICKS	20000
+
+/// Worker_S structure is one benchmark thread's share of the missiles
+/// and what it measured
+
+typedef struct Worker_S {
+
+	MissileStore *store; ///< the missiles being advanced
+
+	size_t first; ///< the worker's first slot
+
+	size_t stride; ///< distance between the worker's slots
+
+	size_t steps; ///< number of steps the worker takes
+
+	uint32_t *latency; ///< nanoseconds taken by each step
+
+	size_t explosions; ///< steps that ended in an explosion
+
+} Worker;
+
+/// Endless_S structure is one endless attack played on a thread of its own
+
+typedef struct Endless_S {
+
+	size_t workers; ///< the number of pool workers
+
+	uint64_t seed; ///< the seed of the city and the missiles
+
+	bool ready; ///< whether the game could be set up
+
+	uint64_t state; ///< a hash of how the game ended
+
+} Endless;
+
+/// Function: now
+///---------------
+/// Reads the monotonic clock
+///
+/// @return the current monotonic time in nanoseconds
+
+static uint64_t now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// Function: parseList
+///---------------------
+/// Reads a comma-separated list of positive numbers
+///
+/// @param text the list
+/// @param values where the numbers are stored, at most MAX_SWEEP of them
+/// @return the number of values, or 0 if the list was invalid
+
+static int parseList(const char * text, long values[]){
+	int count = 0;
+	while (*text != '\0' && count < MAX_SWEEP){
+		char * end;
+		values[count] = strtol(text, &end, 10);
+		if (end == text || values[count] <= 0 || (*end != ',' && *end != '\0'))
+			return 0;
+		count++;
+		text = *end == ',' ? end + 1 : end;
+	}
+	return *text == '\0' ? count : 0;
+}
+
+/// Function: buildCity
+///---------------------
+/// Fills a collision grid with a random city and the ground beneath it
+///
+/// @param grid the grid being filled
+/// @param rng the stream the heights are drawn from
+/// @return the height of the tallest building
+
+static int buildCity(Occupancy * grid, Rng * rng){
+	int tallest = 0;
+	for (int col = 0; col < grid->cols; col++){
+		int height = 2 + rngBelow(rng, 13);
+		if (height > tallest)
+			tallest = height;
+		for (int row = BENCH_ROWS - height; row <= BENCH_ROWS - 2; row++)
+			occupancySet(grid, row, col, CELL_BUILDING);
+	}
+	return tallest;
+}
+
+/// Function: work
+///----------------
+/// Main method for a benchmark thread, advances its missiles in turn and
+/// relaunches each one that explodes
+///
+/// @param arg the Worker being run
+/// @return NULL
+
+static void *work(void * arg){
+	Worker * worker = arg;
+	size_t slot = worker->first;
+	for (size_t step = 0; step < worker->steps; step++){
+		Missile * missile = &worker->store->handles[slot];
+		uint64_t start = now();
+		advance(missile, 0); // no autopilot reads the time
+		worker->latency[step] = now() - start;
+		if (worker->store->exploded[slot] == true){
+			worker->explosions++;
+			resetMissile(missile);
+		}
+		slot += worker->stride;
+		if (slot >= worker->store->count)
+			slot = worker->first;
+	}
+	return NULL;
+}
+
+/// Function: compare
+///-------------------
+/// Orders latencies for qsort
+
+static int compare(const void * a, const void * b){
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/// Function: measure
+///-------------------
+/// Runs one combination and prints its CSV row
+///
+/// @param missiles number of missiles in flight
+/// @param threads number of threads advancing them
+/// @param width number of columns in the city
+/// @param steps total number of steps taken
+/// @param seed seed of the city and the missiles
+/// @return true if the run could be set up
+
+static bool measure(size_t missiles, size_t threads, int width, size_t steps, uint64_t seed){
+	if (threads > missiles)
+		threads = missiles; // every thread needs a missile of its own
+	Occupancy * grid = createOccupancy(BENCH_ROWS, width + 1);
+	MissileStore * store = createMissileStore(missiles);
+	Worker * workers = calloc(threads, sizeof(Worker));
+	pthread_t * ids = calloc(threads, sizeof(pthread_t));
+	uint32_t * latency = malloc(steps * sizeof(uint32_t));
+	if (grid == NULL || store == NULL || workers == NULL || ids == NULL || latency == NULL){
+		if (grid != NULL)
+			destroyOccupancy(grid);
+		if (store != NULL)
+			destroyMissileStore(store);
+		free(workers);
+		free(ids);
+		free(latency);
+		return false;
+	}
+	Rng rng;
+	rngSeed(&rng, seed, UINT64_MAX); // a stream no missile uses
+	int tallest = buildCity(grid, &rng);
+	Game game;
+	if (initThreads(&game, BENCH_ROWS - 2, tallest, width, "bench", false, grid) == false){
+		destroyOccupancy(grid);
+		destroyMissileStore(store);
+		free(workers);
+		free(ids);
+		free(latency);
+		return false;
+	}
+	for (size_t i = 0; i < missiles; i++){
+		rngSeed(&rng, seed, i);
+		createMissile(&game, store, rngBelow(&rng, width + 1), 0, &rng);
+	}
+
+	PriorityLockStats before, after;
+	gameLockStats(&game, &before);
+	uint64_t start = now();
+	for (size_t i = 0; i < threads; i++){
+		workers[i].store = store;
+		workers[i].first = i;
+		workers[i].stride = threads;
+		workers[i].steps = steps / threads + (i < steps % threads);
+		workers[i].latency = latency + i * (steps / threads) + (i < steps % threads ? i : steps % threads);
+		pthread_create(&ids[i], NULL, &work, &workers[i]);
+	}
+	size_t explosions = 0;
+	for (size_t i = 0; i < threads; i++){
+		pthread_join(ids[i], NULL);
+		explosions += workers[i].explosions;
+	}
+	double seconds = (now() - start) / 1e9;
+	gameLockStats(&game, &after);
+
+	qsort(latency, steps, sizeof(uint32_t), &compare);
+	uint64_t acquires = after.acquires - before.acquires;
+	printf("%zu,%zu,%d,%zu,%zu,%.6f,%.0f,%" PRIu32 ",%" PRIu32 ",%.1f,%.1f\n",
+			missiles, threads, width, steps, explosions, seconds, steps / seconds,
+			latency[steps / 2], latency[steps - 1 - steps / 100],
+			acquires ? (double)(after.waitNs - before.waitNs) / acquires : 0.0,
+			acquires ? (double)(after.holdNs - before.holdNs) / acquires : 0.0);
+	fflush(stdout);
+
+	destroyMissileStore(store);
+	releaseThreads(&game);
+	destroyOccupancy(grid);
+	free(workers);
+	free(ids);
+	free(latency);
+	return true;
+}
+
+/// Function: play
+///----------------
+/// Plays rounds of a game in which every falling missile steps once per
+/// round, in slot order, and every exploded one is relaunched afterwards
+///
+/// @param store the missiles
+/// @param rounds number of rounds played
+/// @param batched true to step each round with advanceBatch, false to
+///        call advance on each missile
+/// @param ids scratch space for one slot per missile
+/// @return number of steps taken
+
+static size_t play(MissileStore * store, size_t rounds, bool batched, size_t * ids){
+	size_t steps = 0;
+	for (size_t round = 0; round < rounds; round++){
+		size_t count = 0;
+		for (size_t id = 0; id < store->count; id++)
+			if (store->exploded[id] == false)
+				ids[count++] = id;
+		if (batched == true)
+			advanceBatch(store, ids, count, 0);
+		else
+			for (size_t i = 0; i < count; i++)
+				advance(&store->handles[ids[i]], 0);
+		steps += count;
+		for (size_t id = 0; id < store->count; id++)
+			if (store->exploded[id] == true)
+				resetMissile(&store->handles[id]);
+	}
+	return steps;
+}
+
+/// Function: verify
+///------------------
+/// Plays the same game once with the scalar step and once with the batched
+/// one, checks both end in identical cities and missiles, and prints a CSV
+/// row with the speed of each
+///
+/// @param missiles number of missiles in flight
+/// @param width number of columns in the city
+/// @param steps roughly the number of steps taken by each game
+/// @param seed seed of the city and the missiles
+/// @param matched set to false if the games differed
+/// @return true if the run could be set up
+
+static bool verify(size_t missiles, int width, size_t steps, uint64_t seed, bool * matched){
+	Occupancy * grids[2] = { createOccupancy(BENCH_ROWS, width + 1), createOccupancy(BENCH_ROWS, width + 1) };
+	MissileStore * stores[2] = { createMissileStore(missiles), createMissileStore(missiles) };
+	size_t * ids = malloc(missiles * sizeof(size_t));
+	bool ready = grids[0] != NULL && grids[1] != NULL && stores[0] != NULL && stores[1] != NULL && ids != NULL;
+	size_t rounds = (steps + missiles - 1) / missiles;
+	double seconds[2] = { 0, 0 };
+	size_t taken[2] = { 0, 0 };
+	size_t hits[2][HIT_KINDS]; // what the missiles struck in each game
+	for (int path = 0; path < 2 && ready == true; path++){
+		Rng rng;
+		rngSeed(&rng, seed, UINT64_MAX);
+		int tallest = buildCity(grids[path], &rng);
+		Game game;
+		ready = initThreads(&game, BENCH_ROWS - 2, tallest, width, "bench", false, grids[path]);
+		if (ready == false)
+			break;
+		for (size_t i = 0; i < missiles; i++){
+			rngSeed(&rng, seed, i);
+			createMissile(&game, stores[path], rngBelow(&rng, width + 1), 0, &rng);
+		}
+		uint64_t start = now();
+		taken[path] = play(stores[path], rounds, path == 1, ids);
+		seconds[path] = (now() - start) / 1e9;
+		memcpy(hits[path], game.hits, sizeof(hits[path]));
+		releaseThreads(&game);
+	}
+	if (ready == true){
+		bool same = taken[0] == taken[1] && memcmp(hits[0], hits[1], sizeof(hits[0])) == 0 &&
+				memcmp(grids[0]->cells, grids[1]->cells, (size_t)BENCH_ROWS * (width + 1)) == 0 &&
+				memcmp(stores[0]->height, stores[1]->height, missiles * sizeof(int)) == 0 &&
+				memcmp(stores[0]->column, stores[1]->column, missiles * sizeof(int)) == 0 &&
+				memcmp(stores[0]->exploded, stores[1]->exploded, missiles * sizeof(bool)) == 0;
+		printf("%zu,%d,%zu,%.0f,%.0f,%s\n", missiles, width, taken[0], taken[0] / seconds[0],
+				taken[1] / seconds[1], same == true ? "match" : "MISMATCH");
+		fflush(stdout);
+		if (same == false)
+			*matched = false;
+	}
+	for (int path = 0; path < 2; path++){
+		if (grids[path] != NULL)
+			destroyOccupancy(grids[path]);
+		if (stores[path] != NULL)
+			destroyMissileStore(stores[path]);
+	}
+	free(ids);
+	return ready;
+}
+
+/// Function: burrow
+///------------------
+/// Drops pairs of missiles one after another down two columns with a
+/// building in them. The first pair lands on the roofs; each later one falls
+/// through the debris the one before it left, clearing it, and explodes a
+/// row deeper. Both columns share a stripe, so a batch of the pair is dense
+/// enough for advanceBatch to step it with the kernel.
+///
+/// @param batched true to step with advanceBatch, false with advance
+/// @return true if every missile exploded a row below the last, with only
+///         the deepest debris left in the collision grid
+
+static bool burrow(bool batched){
+	Occupancy * grid = createOccupancy(BENCH_ROWS, 4);
+	MissileStore * store = createMissileStore(2 * BURROW_MISSILES);
+	Game game;
+	bool ready = grid != NULL && store != NULL, burrowed = ready;
+	if (ready == true){
+		for (int row = BURROW_ROOF; row <= BENCH_ROWS - 2; row++){
+			occupancySet(grid, row, 1, CELL_BUILDING);
+			occupancySet(grid, row, 2, CELL_BUILDING);
+		}
+		ready = burrowed = initThreads(&game, BENCH_ROWS - 2, BENCH_ROWS - 1 - BURROW_ROOF, 3, "bench", false, grid);
+	}
+	Rng rng;
+	rngSeed(&rng, 0, 0);
+	for (int i = 0; i < BURROW_MISSILES && burrowed == true; i++){
+		size_t pair[2] = { createMissile(&game, store, 1, 0, &rng)->id, createMissile(&game, store, 2, 0, &rng)->id };
+		while (store->exploded[pair[0]] == false || store->exploded[pair[1]] == false){
+			if (batched == true)
+				advanceBatch(store, pair, 2, 0); // the roofs are level, so the pair falls in step
+			else
+				for (int m = 0; m < 2; m++)
+					advance(&store->handles[pair[m]], 0);
+		}
+		for (int m = 0; m < 2 && burrowed == true; m++){
+			int column = store->column[pair[m]];
+			burrowed = store->height[pair[m]] == BURROW_ROOF + i &&
+					occupancyAt(grid, BURROW_ROOF + i, column) == CELL_DEBRIS;
+			for (int row = BURROW_ROOF; row < BURROW_ROOF + i && burrowed == true; row++)
+				burrowed = occupancyAt(grid, row, column) == CELL_EMPTY; // dug through
+		}
+	}
+	printf("burrow,%s,%s\n", batched == true ? "batch" : "scalar", burrowed == true ? "match" : "MISMATCH");
+	if (ready == true)
+		releaseThreads(&game);
+	if (grid != NULL)
+		destroyOccupancy(grid);
+	if (store != NULL)
+		destroyMissileStore(store);
+	return burrowed;
+}
+
+/// Function: hash
+///---------------
+/// Folds a block of memory into a running FNV-1a hash
+///
+/// @param sum the hash so far
+/// @param data the bytes being added
+/// @param size the number of bytes
+/// @return the new hash
+
+static uint64_t hash(uint64_t sum, const void * data, size_t size){
+	const unsigned char * bytes = data;
+	for (size_t i = 0; i < size; i++)
+		sum = (sum ^ bytes[i]) * 1099511628211u;
+	return sum;
+}
+
+/// Function: endless
+///-------------------
+/// Plays an endless attack on the fast clock with a pool of workers, and
+/// stops it half a tick past ENDLESS_TICKS, when every worker is asleep
+/// between two ticks. Every slot respawns many times over, so the end state
+/// depends on when each respawn started as well as on how missiles fell.
+///
+/// @param workers the number of pool workers
+/// @param seed the seed of the city and the missiles
+/// @param state where a hash of the city, the missiles and the hits is stored
+/// @return true if the game could be set up
+
+static bool endless(size_t workers, uint64_t seed, uint64_t * state){
+	Occupancy * grid = createOccupancy(BENCH_ROWS, ENDLESS_WIDTH + 1);
+	MissileStore * store = createMissileStore(ENDLESS_MISSILES);
+	Game game;
+	bool ready = grid != NULL && store != NULL, initialised = false;
+	if (ready == true){
+		Rng rng;
+		rngSeed(&rng, seed, UINT64_MAX);
+		int tallest = buildCity(grid, &rng);
+		ready = initialised = initThreads(&game, BENCH_ROWS - 2, tallest, ENDLESS_WIDTH, "bench", true, grid);
+	}
+	Pool * pool = NULL;
+	if (ready == true){
+		clockStart(game.clock, CLOCK_FAST);
+		for (size_t i = 0; i < ENDLESS_MISSILES; i++){
+			Rng rng;
+			rngSeed(&rng, seed, i);
+			createMissile(&game, store, rngBelow(&rng, ENDLESS_WIDTH + 1), i * ENDLESS_INTERVAL, &rng);
+		}
+		pool = createPool(workers, store);
+		ready = pool != NULL;
+	}
+	if (ready == true){
+		poolRespawn(pool, ENDLESS_INTERVAL);
+		for (size_t i = 0; i < ENDLESS_MISSILES; i++)
+			poolSubmit(pool, &store->handles[i]);
+		uint64_t end = (uint64_t)ENDLESS_TICKS * TICK_US + TICK_US / 2; // no worker wakes at this time
+		while (clockNow(game.clock) < end)
+			clockSleep(game.clock, end, clockEpoch(game.clock));
+		destroyPool(pool); // the workers are asleep until a later tick, and exit on waking
+		uint64_t sum = 14695981039346656037u;
+		sum = hash(sum, store->height, ENDLESS_MISSILES * sizeof(int));
+		sum = hash(sum, store->column, ENDLESS_MISSILES * sizeof(int));
+		sum = hash(sum, store->exploded, ENDLESS_MISSILES * sizeof(bool));
+		sum = hash(sum, game.hits, sizeof(game.hits));
+		*state = hash(sum, grid->cells, (size_t)BENCH_ROWS * (ENDLESS_WIDTH + 1));
+	}
+	if (initialised == true)
+		releaseThreads(&game);
+	if (grid != NULL)
+		destroyOccupancy(grid);
+	if (store != NULL)
+		destroyMissileStore(store);
+	return ready;
+}
+
+/// Function: playEndless
+///-----------------------
+/// Main method for a thread playing one endless attack of concurrent()
+///
+/// @param arg the Endless declared as void* for pthread operability
+/// @return NULL
+
+static void *playEndless(void *arg){
+	Endless * play = arg;
+	play->ready = endless(play->workers, play->seed, &play->state);
+	return NULL;
+}
+
+/// Function: concurrent
+///----------------------
+/// Plays two endless attacks at the same time, each with a pool and a
+/// clock of its own, and checks that neither disturbs the other
+///
+/// @param seed the seed of both games
+/// @param expected the state the games reach when played alone
+/// @return true if both games reached the expected state
+
+static bool concurrent(uint64_t seed, uint64_t expected){
+	Endless plays[2] = { { 1, seed, false, 0 }, { 4, seed, false, 0 } };
+	pthread_t threads[2];
+	bool started[2];
+	for (int i = 0; i < 2; i++)
+		started[i] = pthread_create(&threads[i], NULL, &playEndless, &plays[i]) == 0;
+	bool matched = true;
+	for (int i = 0; i < 2; i++){
+		if (started[i] == true)
+			pthread_join(threads[i], NULL);
+		if (started[i] == false || plays[i].ready == false || plays[i].state != expected)
+			matched = false;
+	}
+	printf("pool,concurrent,%s\n", matched == true ? "match" : "MISMATCH");
+	return matched;
+}
+
+/// Function: main
+///----------------
+/// Sweeps every combination of the requested sizes
+///
+/// @param argc number of commandline arguments
+/// @param argv the options
+/// @return 0 if success, else EXIT_FAILURE
+
+int main(int argc, char* argv[]){
+	const char * usage = "usage: ./bench [-m missiles,...] [-t threads,...] [-w widths,...] [-n steps] [-s seed] [-v]\n";
+	long missiles[MAX_SWEEP], threads[MAX_SWEEP], widths[MAX_SWEEP];
+	int missileCount = parseList(DEFAULT_MISSILES, missiles);
+	int threadCount = parseList(DEFAULT_THREADS, threads);
+	int widthCount = parseList(DEFAULT_WIDTHS, widths);
+	long steps = DEFAULT_STEPS;
+	uint64_t seed = 1;
+	bool check = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "m:t:w:n:s:v")) != -1){
+		switch (opt){
+			case 'm':
+				missileCount = parseList(optarg, missiles);
+				break;
+			case 't':
+				threadCount = parseList(optarg, threads);
+				break;
+			case 'w':
+				widthCount = parseList(optarg, widths);
+				break;
+			case 'n':
+				steps = atol(optarg);
+				break;
+			case 's':
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'v':
+				check = true;
+				break;
+			default:
+				fprintf(stderr, "%s", usage);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || missileCount == 0 || threadCount == 0 || widthCount == 0 || steps <= 0){
+		fprintf(stderr, "%s", usage);
+		return EXIT_FAILURE;
+	}
+	if (check == true){ // the batched step against the scalar one, single threaded
+		bool matched = true;
+		printf("missiles,width,steps,scalar_steps/s,batch_steps/s,result\n");
+		for (int w = 0; w < widthCount; w++){
+			for (int m = 0; m < missileCount; m++){
+				if (verify(missiles[m], widths[w], steps, seed, &matched) == false){
+					fprintf(stderr, "%s", "Error: out of memory.\n");
+					return EXIT_FAILURE;
+				}
+			}
+		}
+		printf("check,path,result\n"); // game rules the random cities rarely exercise
+		if (burrow(false) == false || burrow(true) == false)
+			matched = false;
+		uint64_t expected; // an endless attack comes out the same whoever steps it
+		if (endless(1, seed, &expected) == false){
+			fprintf(stderr, "%s", "Error: out of memory.\n");
+			return EXIT_FAILURE;
+		}
+		if (concurrent(seed, expected) == false) // nor does another game in the process change it
+			matched = false;
+		for (int t = 0; t < threadCount; t++){
+			uint64_t state;
+			if (endless(threads[t], seed, &state) == false){
+				fprintf(stderr, "%s", "Error: out of memory.\n");
+				return EXIT_FAILURE;
+			}
+			printf("endless,%ld workers,%s\n", threads[t], state == expected ? "match" : "MISMATCH");
+			if (state != expected)
+				matched = false;
+		}
+		return matched == true ? 0 : EXIT_FAILURE;
+	}
+	printf("missiles,threads,width,steps,explosions,seconds,steps/s,p50_ns,p99_ns,lock_wait_ns,lock_hold_ns\n");
+	for (int w = 0; w < widthCount; w++){
+		for (int m = 0; m < missileCount; m++){
+			for (int t = 0; t < threadCount; t++){
+				if (measure(missiles[m], threads[t], widths[w], steps, seed) == false){
+					fprintf(stderr, "%s", "Error: out of memory.\n");
+					return EXIT_FAILURE;
+				}
+			}
+		}
+	}
+	return 0;
+}
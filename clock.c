@@ -0,0 +1,286 @@
+/// Program: clock.c
+///------------------
+/// Virtual clock behind every game delay. In real time and scaled modes
+/// virtual time is the monotonic clock multiplied by the speed. In fast
+/// mode it is a counter that jumps to the earliest sleeper's deadline as
+/// soon as every joined thread is asleep, so nothing waits on wall time.
+/// Cancelling the clock wakes every sleeper and ends every later sleep at
+/// once, which is how the game's threads are stopped. Each game has its
+/// own clock, so games run side by side never hold each other's time back.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "clock.h"
+#include "stats.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+/// Sleeper_S structure is one thread asleep in fast mode
+
+typedef struct Sleeper_S {
+
+	uint64_t until; ///< the sleeper's deadline
+
+	uint64_t seen; ///< the epoch the sleeper went to sleep in
+
+	struct Sleeper_S *next; ///< the next sleeper
+
+} Sleeper;
+
+struct Clock_S {
+
+	pthread_mutex_t mutex; ///< guards everything below
+
+	pthread_cond_t changed; ///< broadcast when time jumps or clockWake is called
+
+	double speed; ///< virtual seconds per real second, CLOCK_FAST for fast mode
+
+	uint64_t origin; ///< statsNow() nanoseconds of virtual time 0
+
+	uint64_t virtualNow; ///< fast mode's current time, read atomically
+
+	uint64_t epoch; ///< clockWake calls so far
+
+	bool cancelled; ///< set for good by clockCancel, read atomically
+
+	size_t joined; ///< threads whose sleeps hold fast mode's time back
+
+	size_t asleep; ///< joined threads asleep in clockSleep
+
+	Sleeper *sleepers; ///< fast mode's sleeping threads
+};
+
+/// Function: createClock
+///-----------------------
+/// Creates a clock running in real time from 0
+///
+/// @return Clock pointer to the dynamically allocated clock, or NULL
+
+Clock * createClock(void){
+	Clock * new = malloc(sizeof(struct Clock_S));
+	if (new == NULL)
+		return NULL;
+	pthread_mutex_init(&new->mutex, NULL);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // deadlines use the monotonic clock
+	pthread_cond_init(&new->changed, &attr);
+	pthread_condattr_destroy(&attr);
+	new->speed = 1.0;
+	new->origin = statsNow();
+	new->virtualNow = 0;
+	new->epoch = 0;
+	new->cancelled = false;
+	new->joined = 0;
+	new->asleep = 0;
+	new->sleepers = NULL;
+	return new;
+}
+
+/// Function: destroyClock
+///------------------------
+/// De-allocates a clock
+///
+/// @param clock the object to be de-allocated
+
+void destroyClock(Clock * clock){
+	assert(clock != NULL && clock->asleep == 0);
+	pthread_cond_destroy(&clock->changed);
+	pthread_mutex_destroy(&clock->mutex);
+	free(clock);
+}
+
+/// Function: clockStart
+///----------------------
+/// Sets the clock's speed and starts virtual time at 0
+///
+/// @param clock the clock being started
+/// @param scale virtual seconds per real second, or CLOCK_FAST
+
+void clockStart(Clock * clock, double scale){
+	assert(clock != NULL && scale >= 0);
+	pthread_mutex_lock(&clock->mutex);
+	assert(clock->asleep == 0 && clock->sleepers == NULL);
+	clock->speed = scale;
+	clock->origin = statsNow();
+	__atomic_store_n(&clock->virtualNow, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockFast
+///---------------------
+/// Whether the clock runs as fast as possible
+///
+/// @param clock the clock being read
+/// @return true in fast mode
+
+bool clockFast(Clock * clock){
+	return clock->speed == CLOCK_FAST;
+}
+
+/// Function: clockNow
+///--------------------
+/// The current virtual time
+///
+/// @param clock the clock being read
+/// @return microseconds of virtual time since clockStart
+
+uint64_t clockNow(Clock * clock){
+	if (clock->speed == CLOCK_FAST)
+		return __atomic_load_n(&clock->virtualNow, __ATOMIC_ACQUIRE);
+	return (uint64_t)((statsNow() - clock->origin) * clock->speed / 1000);
+}
+
+/// Function: jump
+///----------------
+/// Moves fast mode's time to the earliest deadline once every joined
+/// thread is asleep, the clock's mutex must be held. A sleeper clockWake
+/// woke is still counted asleep until it runs, so it holds time back too.
+///
+/// @param clock the clock whose time may move
+
+static void jump(Clock * clock){
+	if (clock->speed != CLOCK_FAST || clock->joined == 0 || clock->asleep < clock->joined)
+		return;
+	uint64_t earliest = CLOCK_NEVER;
+	for (Sleeper * sleeper = clock->sleepers; sleeper != NULL; sleeper = sleeper->next){
+		if (sleeper->seen != clock->epoch)
+			return; // woken, and about to look at the time again
+		if (sleeper->until < earliest)
+			earliest = sleeper->until;
+	}
+	if (earliest != CLOCK_NEVER && earliest > clock->virtualNow){
+		__atomic_store_n(&clock->virtualNow, earliest, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&clock->changed);
+	}
+}
+
+/// Function: clockJoin
+///---------------------
+/// Counts one more thread whose sleeps hold virtual time back
+///
+/// @param clock the clock being joined
+
+void clockJoin(Clock * clock){
+	pthread_mutex_lock(&clock->mutex);
+	clock->joined++;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockLeave
+///----------------------
+/// Counts one joined thread out again, which may let fast mode's time move
+///
+/// @param clock the clock being left
+
+void clockLeave(Clock * clock){
+	pthread_mutex_lock(&clock->mutex);
+	assert(clock->joined > 0);
+	clock->joined--;
+	jump(clock);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockEpoch
+///----------------------
+/// Reads the count of clockWake calls
+///
+/// @param clock the clock being read
+/// @return the current epoch
+
+uint64_t clockEpoch(Clock * clock){
+	return __atomic_load_n(&clock->epoch, __ATOMIC_ACQUIRE);
+}
+
+/// Function: clockSleep
+///----------------------
+/// Sleeps until virtual time reaches a deadline, until clockWake is
+/// called after the epoch was read, or until the clock is cancelled
+///
+/// @param clock the clock slept on
+/// @param until the deadline in virtual microseconds, or CLOCK_NEVER
+/// @param seen the value clockEpoch returned before the deadline was chosen
+
+void clockSleep(Clock * clock, uint64_t until, uint64_t seen){
+	pthread_mutex_lock(&clock->mutex);
+	if (clock->speed == CLOCK_FAST){
+		Sleeper self = { until, seen, clock->sleepers };
+		clock->sleepers = &self;
+		clock->asleep++;
+		jump(clock);
+		while (clock->epoch == seen && clock->virtualNow < until && clock->cancelled == false)
+			pthread_cond_wait(&clock->changed, &clock->mutex);
+		clock->asleep--;
+		Sleeper ** link = &clock->sleepers;
+		while (*link != &self)
+			link = &(*link)->next;
+		*link = self.next;
+	} else {
+		while (clock->epoch == seen && clockNow(clock) < until && clock->cancelled == false){
+			if (until == CLOCK_NEVER){
+				pthread_cond_wait(&clock->changed, &clock->mutex);
+				continue;
+			}
+			uint64_t deadline = clock->origin + (uint64_t)(until * 1000 / clock->speed) + 1; // rounds up past until
+			struct timespec ts = { deadline / 1000000000, deadline % 1000000000 };
+			pthread_cond_timedwait(&clock->changed, &clock->mutex, &ts);
+		}
+	}
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockDelay
+///----------------------
+/// Sleeps for an amount of virtual time, whatever wakes happen, unless the
+/// clock is cancelled
+///
+/// @param clock the clock slept on
+/// @param microseconds the virtual time slept
+
+void clockDelay(Clock * clock, uint64_t microseconds){
+	uint64_t until = clockNow(clock) + microseconds;
+	while (clockNow(clock) < until && clockCancelled(clock) == false)
+		clockSleep(clock, until, clockEpoch(clock));
+}
+
+/// Function: clockWake
+///---------------------
+/// Wakes every sleeper so it can look at its deadline again
+///
+/// @param clock the clock whose sleepers are woken
+
+void clockWake(Clock * clock){
+	pthread_mutex_lock(&clock->mutex);
+	__atomic_add_fetch(&clock->epoch, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&clock->changed);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockCancel
+///-----------------------
+/// Wakes every sleeper and makes every later sleep return at once
+///
+/// @param clock the clock being cancelled
+
+void clockCancel(Clock * clock){
+	pthread_mutex_lock(&clock->mutex);
+	__atomic_store_n(&clock->cancelled, true, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&clock->epoch, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&clock->changed);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+/// Function: clockCancelled
+///--------------------------
+/// Whether the clock has been cancelled
+///
+/// @param clock the clock being read
+/// @return true once clockCancel has been called
+
+bool clockCancelled(Clock * clock){
+	return __atomic_load_n(&clock->cancelled, __ATOMIC_ACQUIRE);
+}
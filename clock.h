@@ -0,0 +1,129 @@
+/// clock.h - header file for the game's virtual clock
+///
+/// @author Brennan Reed
+///
+/// This is the interface every game delay goes through. Virtual time is
+/// counted in microseconds from clockStart and runs at a chosen speed:
+/// 1 for real time, 10 for ten times faster, or CLOCK_FAST to run as fast
+/// as possible. In fast mode time only moves while every participating
+/// thread is asleep in clockSleep, and then jumps straight to the earliest
+/// deadline, so a game plays out the same at any speed. Cancelling the
+/// clock ends every sleep on it, for good. Every game has a clock of its
+/// own, so games in one process keep separate time.
+
+#ifndef _CLOCK_H
+#define _CLOCK_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/// CLOCK_FAST is the speed that runs the game as fast as possible
+
+#define CLOCK_FAST 0.0
+
+/// CLOCK_NEVER is a deadline that is never reached
+
+#define CLOCK_NEVER UINT64_MAX
+
+/// Clock_S structure is one game's virtual time and the threads sleeping
+/// on it. The definition is private to clock.c.
+
+typedef struct Clock_S Clock;
+
+/// createClock - Create a clock running in real time from 0.
+///
+/// @return Clock pointer to a dynamically allocated Clock object, or NULL
+
+Clock * createClock( void );
+
+/// destroyClock - Destroy all dynamically allocated storage for a clock.
+///
+/// @param clock the object to be de-allocated
+/// @pre no thread is sleeping on the clock
+
+void destroyClock( Clock *clock );
+
+/// clockStart - Sets the clock's speed and starts virtual time at 0.
+///
+/// @param clock the clock being started
+/// @param speed virtual seconds per real second, or CLOCK_FAST
+/// @pre no thread is sleeping on the clock
+
+void clockStart( Clock *clock, double speed );
+
+/// clockFast - Whether the clock runs as fast as possible.
+///
+/// @param clock the clock being read
+/// @return true in fast mode
+
+bool clockFast( Clock *clock );
+
+/// clockNow - The current virtual time.
+///
+/// @param clock the clock being read
+/// @return microseconds of virtual time since clockStart
+
+uint64_t clockNow( Clock *clock );
+
+/// clockJoin - Counts one more thread whose sleeps hold virtual time back;
+/// in fast mode time only moves once every joined thread is asleep.
+///
+/// @param clock the clock being joined
+
+void clockJoin( Clock *clock );
+
+/// clockLeave - Counts one joined thread out again.
+///
+/// @param clock the clock being left
+
+void clockLeave( Clock *clock );
+
+/// clockEpoch - Reads the count of clockWake calls, to be handed to
+/// clockSleep so a wake between the two is not missed.
+///
+/// @param clock the clock being read
+/// @return the current epoch
+
+uint64_t clockEpoch( Clock *clock );
+
+/// clockSleep - Sleeps until virtual time reaches a deadline, until
+/// clockWake is called after the epoch was read, or until the clock is
+/// cancelled.
+///
+/// @param clock the clock slept on
+/// @param until the deadline in virtual microseconds, or CLOCK_NEVER
+/// @param epoch the value clockEpoch returned before the deadline was chosen
+/// @pre in fast mode, the caller has joined the clock
+
+void clockSleep( Clock *clock, uint64_t until, uint64_t epoch );
+
+/// clockDelay - Sleeps for an amount of virtual time, whatever wakes happen,
+/// unless the clock is cancelled.
+///
+/// @param clock the clock slept on
+/// @param microseconds the virtual time slept
+/// @pre in fast mode, the caller has joined the clock
+
+void clockDelay( Clock *clock, uint64_t microseconds );
+
+/// clockWake - Wakes every sleeper so it can look at its deadline again.
+///
+/// @param clock the clock whose sleepers are woken
+
+void clockWake( Clock *clock );
+
+/// clockCancel - Wakes every sleeper and makes every later sleep return at
+/// once. Safe to call from any thread, but not from a signal handler;
+/// clockStart does not undo it.
+///
+/// @param clock the clock being cancelled
+
+void clockCancel( Clock *clock );
+
+/// clockCancelled - Whether the clock has been cancelled.
+///
+/// @param clock the clock being read
+/// @return true once clockCancel has been called
+
+bool clockCancelled( Clock *clock );
+
+#endif
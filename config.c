@@ -0,0 +1,210 @@
+/// Program: config.c
+///-------------------
+/// Config-file parser. The file is memory-mapped and scanned once; city
+/// heights are parsed in place and stored in an array sized up front from
+/// the file's length.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// Parser_S structure is the parser's position in the mapped file
+
+typedef struct Parser_S {
+
+	const char *path; ///< the config-file's name, for errors
+
+	const char *text; ///< start of the mapped file
+
+	const char *end; ///< one past the last byte of the file
+
+	const char *line; ///< start of the current line
+
+	size_t lineNumber; ///< the current line, counted from 1
+
+} Parser;
+
+/// Function: fail
+///----------------
+/// Reports a parse error at a position in the file
+///
+/// @param parser the parser that failed
+/// @param at the offending byte
+/// @param message what was wrong
+/// @return false, for returning straight from the caller
+
+static bool fail(const Parser * parser, const char * at, const char * message){
+	fprintf(stderr, "%s:%zu:%zu: Error: %s\n", parser->path, parser->lineNumber,
+			(size_t)(at - parser->line) + 1, message);
+	return false;
+}
+
+/// Function: copyLine
+///--------------------
+/// Copies the rest of a line, without its line ending, into a new string
+///
+/// @param start the first byte of the text
+/// @param end one past the last byte of the line, before any newline
+/// @return the dynamically allocated copy
+
+static char * copyLine(const char * start, const char * end){
+	if (end > start && end[-1] == '\r')
+		end--; // tolerates files with DOS line endings
+	char * copy = malloc(end - start + 1);
+	if (copy != NULL){
+		memcpy(copy, start, end - start);
+		copy[end - start] = '\0';
+	}
+	return copy;
+}
+
+/// Function: parseCity
+///---------------------
+/// Parses one line of the cityscape, appending each height to the config
+///
+/// @param parser the parser, positioned at the start of the line
+/// @param end one past the last byte of the line
+/// @param config the config receiving the heights
+/// @return true if the line held only whitespace-separated integers
+
+static bool parseCity(Parser * parser, const char * end, Config * config){
+	const char * p = parser->line;
+	while (p < end){
+		if (*p == ' ' || *p == '\t' || *p == '\r'){
+			p++;
+			continue;
+		}
+		if (*p < '0' || *p > '9')
+			return fail(parser, p, "city layout must contain only numbers.");
+		const char * start = p;
+		long height = 0;
+		while (p < end && *p >= '0' && *p <= '9'){
+			height = height * 10 + (*p - '0');
+			if (height > INT_MAX)
+				return fail(parser, start, "building height is too large.");
+			p++;
+		}
+		config->heights[config->columns++] = height;
+	}
+	return true;
+}
+
+/// Function: parseConfig
+///-----------------------
+/// Reads a config-file into a Config object
+///
+/// @param path the config-file's name
+/// @param config where the result is stored
+/// @return true if the file was valid
+
+bool parseConfig(const char * path, Config * config){
+	memset(config, 0, sizeof(Config));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		fprintf(stderr, "%s", "Error: specified config-file not found.\n");
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		fprintf(stderr, "%s", "Error: specified config-file not found.\n");
+		return false;
+	}
+	size_t size = info.st_size;
+	const char * text = NULL;
+	if (size > 0){
+		text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (text == MAP_FAILED){
+			close(fd);
+			fprintf(stderr, "%s", "Error: unable to read the config-file.\n");
+			return false;
+		}
+		madvise((void *)text, size, MADV_SEQUENTIAL);
+	}
+	close(fd); // the mapping stays valid
+
+	// every height takes at least one digit and one separator, so half the
+	// file's size (plus one for a missing final newline) always fits
+	config->heights = malloc((size / 2 + 1) * sizeof(int));
+	Parser parser = { path, text, text + size, text, 0 };
+	size_t section = 0;
+	bool valid = config->heights != NULL;
+	if (valid == false)
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+	while (valid == true && parser.line < parser.end){
+		parser.lineNumber++;
+		const char * end = memchr(parser.line, '\n', parser.end - parser.line);
+		if (end == NULL)
+			end = parser.end;
+		if (*parser.line != '#'){ // comment lines carry nothing
+			const char * p = parser.line;
+			switch (section){
+				case 0:
+					config->defender = copyLine(parser.line, end);
+					section++;
+					break;
+				case 1:
+					config->attacker = copyLine(parser.line, end);
+					section++;
+					break;
+				case 2:
+					config->missiles = 0;
+					const char * digits = NULL; // the count's first digit, where an overflow is reported
+					for (; p < end && valid == true; p++){
+						if (*p >= '0' && *p <= '9'){
+							if (digits == NULL)
+								digits = p;
+							config->missiles = config->missiles * 10 + (*p - '0');
+							if (config->missiles > INT_MAX) // missile slots are int timer ids
+								valid = fail(&parser, digits, "missile specification is too large.");
+						} else if (*p != ' ' && *p != '\t' && *p != '\r')
+							valid = fail(&parser, p, "missile specification must be a number.");
+					}
+					section++;
+					break;
+				default:
+					valid = parseCity(&parser, end, config);
+					break;
+			}
+		}
+		parser.line = end + 1;
+	}
+	if (text != NULL)
+		munmap((void *)text, size);
+	if (valid == true && section < 3){
+		const char * missing[] = { "missing defender name.", "missing attacker name.",
+				"missing missile specification." };
+		fprintf(stderr, "%s: Error: %s\n", path, missing[section]);
+		valid = false;
+	}
+	if (valid == false){
+		freeConfig(config);
+		return false;
+	}
+	int * heights = realloc(config->heights, (config->columns + 1) * sizeof(int)); // gives back the estimate's slack
+	if (heights != NULL)
+		config->heights = heights;
+	return true;
+}
+
+/// Function: freeConfig
+///----------------------
+/// De-allocates everything a Config holds
+///
+/// @param config the object whose contents are de-allocated
+
+void freeConfig(Config * config){
+	free(config->defender);
+	free(config->attacker);
+	free(config->heights);
+	memset(config, 0, sizeof(Config));
+}
@@ -0,0 +1,44 @@
+/// config.h - header file for the config-file parser
+///
+/// @author Brennan Reed
+///
+/// This is the interface for reading a game's config-file: the defender
+/// and attacker names, the missile count, and the cityscape's heights.
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Config_S structure holds everything a config-file specifies.
+
+typedef struct Config_S {
+
+    char *defender; ///< name of the defender
+
+    char *attacker; ///< name of the attacker
+
+    size_t missiles; ///< number of missiles, 0 for an endless attack
+
+    int *heights; ///< height of the city in each column
+
+    size_t columns; ///< number of columns in heights
+
+} Config;
+
+/// parseConfig - Reads a config-file into a Config object.
+///
+/// @param path the config-file's name
+/// @param config where the result is stored
+/// @return true if the file was valid; otherwise an error naming the line
+///         and column is printed to stderr and config is left empty
+
+bool parseConfig( const char *path, Config *config );
+
+/// freeConfig - Destroy all dynamically allocated storage for a Config.
+///
+/// @param config the object whose contents are de-allocated
+
+void freeConfig( Config *config );
+
+#endif
@@ -0,0 +1,569 @@
+/// Program: display.c
+///--------------------
+/// Output backends for the game: curses for the terminal, a direct ANSI
+/// backend that sends the terminal only what changed, and an in-memory
+/// character grid for headless runs. Curses only draws; keys are read
+/// straight from stdin with poll(), so waiting for input never enters
+/// curses while the render thread is refreshing.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "display.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <curses.h>
+
+#define ESCAPE_TIMEOUT_MS	25	///< how long the rest of an escape sequence may take
+#define ANSI_MERGE_GAP	4	///< unchanged cells rewritten rather than skipped with a cursor move
+#define ANSI_MOVE_BYTES	16	///< room for the longest cursor movement sequence
+
+/// the backend every display function forwards to
+static Display display;
+
+/// cells of the grid backend, rows * cols characters
+static char * grid;
+
+/// when the last key was read, in statsNow() nanoseconds
+static uint64_t keyTime;
+
+/// displayInterrupt writes to the pipe's second end; readers poll the first
+/// beside stdin and never drain it, so every later read is interrupted too
+static int wake[2] = { -1, -1 };
+
+/// the ANSI backend's cells: back is what the game drew, front is what the
+/// terminal shows; each is rows * cols characters
+static char * back;
+static char * front;
+
+/// the ANSI backend's frame being assembled, sent with one write()
+static char * output;
+
+/// where the terminal's cursor is, row -1 when unknown
+static int cursorRow = -1;
+static int cursorCol;
+
+/// the terminal's settings before the ANSI backend changed them
+static struct termios savedTerminal;
+
+/// Function: cursesPut
+///---------------------
+/// Draws a character on the curses window
+
+static void cursesPut(int row, int col, char ch){
+	mvaddch(row, col, ch);
+}
+
+/// Function: cursesGet
+///---------------------
+/// Reads a character back from the curses window
+
+static char cursesGet(int row, int col){
+	return mvinch(row, col) & A_CHARTEXT;
+}
+
+/// Function: cursesClearToEol
+///----------------------------
+/// Blanks the rest of a row on the curses window
+
+static void cursesClearToEol(int row, int col){
+	move(row, col);
+	clrtoeol();
+}
+
+/// Function: cursesRefresh
+///-------------------------
+/// Pushes pending changes to the terminal
+
+static void cursesRefresh(void){
+	refresh();
+}
+
+/// Function: readByte
+///--------------------
+/// Reads one byte of terminal input once poll() reports one
+///
+/// @param timeout milliseconds to wait, or -1 to wait for ever
+/// @return the byte, or DISPLAY_KEY_NONE on timeout, end of input or
+///         once displayInterrupt has been called
+
+static int readByte(int timeout){
+	struct pollfd fds[2] = { { STDIN_FILENO, POLLIN, 0 }, { wake[0], POLLIN, 0 } }; // poll skips a missing pipe
+	int ready;
+	do {
+		ready = poll(fds, 2, timeout);
+	} while (ready < 0 && errno == EINTR && timeout < 0); // signals such as SIGUSR1 interrupt poll
+	if (ready <= 0 || (fds[1].revents & POLLIN) != 0)
+		return DISPLAY_KEY_NONE;
+	unsigned char ch;
+	if (read(STDIN_FILENO, &ch, 1) != 1)
+		return DISPLAY_KEY_NONE;
+	return ch;
+}
+
+/// Function: terminalKey
+///-----------------------
+/// Waits for a key press on stdin and decodes the arrow keys' escape
+/// sequences, in both their normal and keypad forms
+///
+/// @return a character, or one of the DISPLAY_KEY_ codes
+
+static int terminalKey(void){
+	int ch = readByte(-1);
+	keyTime = statsNow(); // the key is in hand; everything after is game latency
+	if (ch != 27) // escape
+		return ch;
+	int next = readByte(ESCAPE_TIMEOUT_MS);
+	if (next != '[' && next != 'O')
+		return next == DISPLAY_KEY_NONE ? ch : DISPLAY_KEY_NONE; // a lone escape key
+	switch (readByte(ESCAPE_TIMEOUT_MS)){
+		case 'D':
+			return DISPLAY_KEY_LEFT;
+		case 'C':
+			return DISPLAY_KEY_RIGHT;
+		default:
+			return DISPLAY_KEY_NONE; // other keys are not used by the game
+	}
+}
+
+/// Function: cursesClose
+///-----------------------
+/// Terminates the curses environment
+
+static void cursesClose(void){
+	endwin();
+}
+
+/// Function: openWake
+///--------------------
+/// Creates the pipe displayInterrupt wakes readers through; without it
+/// reads simply cannot be interrupted
+
+static void openWake(void){
+	if (wake[0] < 0 && pipe(wake) != 0)
+		wake[0] = wake[1] = -1;
+}
+
+/// Function: writeAll
+///--------------------
+/// Writes a buffer to the terminal, however many calls it takes
+///
+/// @param buffer the bytes being written
+/// @param length the number of bytes
+
+static void writeAll(const char * buffer, size_t length){
+	while (length > 0){
+		ssize_t written = write(STDOUT_FILENO, buffer, length);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return; // the terminal has gone; nothing more can be shown
+		buffer += written;
+		length -= written;
+	}
+}
+
+/// Function: ansiPut
+///-------------------
+/// Draws a character into the back buffer
+
+static void ansiPut(int row, int col, char ch){
+	if (row < 0 || row >= display.rows || col < 0 || col >= display.cols)
+		return;
+	back[row * display.cols + col] = ch;
+}
+
+/// Function: ansiGet
+///-------------------
+/// Reads a character back from the back buffer
+
+static char ansiGet(int row, int col){
+	if (row < 0 || row >= display.rows || col < 0 || col >= display.cols)
+		return ' ';
+	return back[row * display.cols + col];
+}
+
+/// Function: ansiClearToEol
+///--------------------------
+/// Blanks the rest of a row in the back buffer
+
+static void ansiClearToEol(int row, int col){
+	if (row < 0 || row >= display.rows || col >= display.cols)
+		return;
+	if (col < 0)
+		col = 0;
+	memset(back + row * display.cols + col, ' ', display.cols - col);
+}
+
+/// Function: ansiMove
+///--------------------
+/// Appends the shortest cursor movement this backend knows to a frame
+///
+/// @param used bytes of the frame so far
+/// @param row the row moved to
+/// @param col the column moved to
+/// @return bytes of the frame after the movement
+
+static size_t ansiMove(size_t used, int row, int col){
+	if (row == cursorRow && col == cursorCol)
+		return used;
+	if (row == cursorRow && col > cursorCol) // forward along the same row
+		return used + snprintf(output + used, ANSI_MOVE_BYTES, "\x1b[%dC", col - cursorCol);
+	return used + snprintf(output + used, ANSI_MOVE_BYTES, "\x1b[%d;%dH", row + 1, col + 1);
+}
+
+/// Function: ansiRefresh
+///-----------------------
+/// Sends the terminal every run of cells that differs between the back and
+/// front buffers in a single write(). Runs separated by only a few
+/// unchanged cells are sent as one, since rewriting those cells is cheaper
+/// than moving the cursor over them.
+
+static void ansiRefresh(void){
+	size_t used = 0;
+	for (int row = 0; row < display.rows; row++){
+		char * drawn = back + row * display.cols;
+		char * shown = front + row * display.cols;
+		int col = 0;
+		while (col < display.cols){
+			if (drawn[col] == shown[col]){
+				col++;
+				continue;
+			}
+			int last = col; // the run's last changed cell
+			for (int next = col + 1; next < display.cols && next - last <= ANSI_MERGE_GAP; next++){
+				if (drawn[next] != shown[next])
+					last = next;
+			}
+			used = ansiMove(used, row, col);
+			memcpy(output + used, drawn + col, last - col + 1);
+			memcpy(shown + col, drawn + col, last - col + 1);
+			used += last - col + 1;
+			cursorRow = row;
+			cursorCol = last + 1;
+			if (cursorCol == display.cols)
+				cursorRow = -1; // terminals differ on where a full row leaves the cursor
+			col = last + 1;
+		}
+	}
+	if (used > 0)
+		writeAll(output, used);
+	statsAdd(STAT_OUTPUT_BYTES, used);
+	statsRecord(HIST_FRAME_BYTES, used);
+}
+
+/// Function: ansiClose
+///---------------------
+/// Restores the terminal and de-allocates the ANSI backend's buffers
+
+static void ansiClose(void){
+	const char * restore = "\x1b[0m\x1b[?25h\x1b[?1049l"; // cursor back, main screen back
+	writeAll(restore, strlen(restore));
+	tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+	free(back);
+	free(front);
+	free(output);
+	back = front = output = NULL;
+	cursorRow = -1;
+}
+
+/// Function: gridPut
+///-------------------
+/// Stores a character in the in-memory grid
+
+static void gridPut(int row, int col, char ch){
+	if (row < 0 || row >= display.rows || col < 0 || col >= display.cols)
+		return;
+	grid[row * display.cols + col] = ch;
+}
+
+/// Function: gridGet
+///-------------------
+/// Reads a character from the in-memory grid
+
+static char gridGet(int row, int col){
+	if (row < 0 || row >= display.rows || col < 0 || col >= display.cols)
+		return ' ';
+	return grid[row * display.cols + col];
+}
+
+/// Function: gridClearToEol
+///--------------------------
+/// Blanks the rest of a row in the in-memory grid
+
+static void gridClearToEol(int row, int col){
+	if (row < 0 || row >= display.rows || col >= display.cols)
+		return;
+	if (col < 0)
+		col = 0;
+	memset(grid + row * display.cols + col, ' ', display.cols - col);
+}
+
+/// Function: gridRefresh
+///-----------------------
+/// Nothing to flush, the grid is always current
+
+static void gridRefresh(void){
+}
+
+/// Function: gridKey
+///-------------------
+/// Nobody is typing at a headless game
+///
+/// @return DISPLAY_KEY_NONE
+
+static int gridKey(void){
+	return DISPLAY_KEY_NONE;
+}
+
+/// Function: gridClose
+///---------------------
+/// De-allocates the in-memory grid
+
+static void gridClose(void){
+	free(grid);
+	grid = NULL;
+}
+
+/// Function: openCursesDisplay
+///-----------------------------
+/// Starts curses on the terminal and selects it as the display
+///
+/// @return true if the terminal could be initialised
+
+bool openCursesDisplay(void){
+	if (initscr() == NULL) // initializes stdscr, a curses global variable
+		return false;
+	cbreak();
+	noecho(); // disables typed characters appearing in terminal
+	openWake();
+	display.put = cursesPut;
+	display.get = cursesGet;
+	display.clearToEol = cursesClearToEol;
+	display.flush = cursesRefresh;
+	display.key = terminalKey;
+	display.close = cursesClose;
+	display.interactive = true;
+	display.rows = getmaxy(stdscr);
+	display.cols = getmaxx(stdscr);
+	return true;
+}
+
+/// Function: openAnsiDisplay
+///----------------------------
+/// Takes over the terminal with raw escape sequences and selects it as the
+/// display. Input is switched to unbuffered, unechoed bytes; signals such
+/// as control-C still work.
+///
+/// @return true if stdin and stdout are a terminal and the buffers could
+///         be allocated
+
+bool openAnsiDisplay(void){
+	struct winsize size;
+	if (isatty(STDOUT_FILENO) == 0 || tcgetattr(STDIN_FILENO, &savedTerminal) != 0 ||
+			ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0)
+		return false;
+	size_t cells = (size_t)size.ws_row * size.ws_col;
+	back = malloc(cells);
+	front = malloc(cells);
+	output = malloc(cells * (ANSI_MOVE_BYTES + 1)); // every cell its own run, the worst case
+	if (back == NULL || front == NULL || output == NULL){
+		free(back);
+		free(front);
+		free(output);
+		back = front = output = NULL;
+		return false;
+	}
+	memset(back, ' ', cells);
+	memset(front, ' ', cells); // matches the screen once it is cleared
+	openWake();
+	struct termios raw = savedTerminal;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	const char * start = "\x1b[?1049h\x1b[0m\x1b[2J\x1b[H\x1b[?25l"; // alternate screen, cleared, no cursor
+	writeAll(start, strlen(start));
+	cursorRow = 0;
+	cursorCol = 0;
+	display.put = ansiPut;
+	display.get = ansiGet;
+	display.clearToEol = ansiClearToEol;
+	display.flush = ansiRefresh;
+	display.key = terminalKey;
+	display.close = ansiClose;
+	display.interactive = true;
+	display.rows = size.ws_row;
+	display.cols = size.ws_col;
+	return true;
+}
+
+/// Function: openGridDisplay
+///---------------------------
+/// Selects an in-memory grid as the display
+///
+/// @param rows number of rows in the grid
+/// @param cols number of columns in the grid
+/// @return true if the grid could be allocated
+
+bool openGridDisplay(int rows, int cols){
+	assert(rows > 0 && cols > 0);
+	grid = malloc((size_t)rows * cols);
+	if (grid == NULL)
+		return false;
+	memset(grid, ' ', (size_t)rows * cols);
+	display.put = gridPut;
+	display.get = gridGet;
+	display.clearToEol = gridClearToEol;
+	display.flush = gridRefresh;
+	display.key = gridKey;
+	display.close = gridClose;
+	display.interactive = false;
+	display.rows = rows;
+	display.cols = cols;
+	return true;
+}
+
+/// Function: closeDisplay
+///------------------------
+/// Releases the selected backend
+
+void closeDisplay(void){
+	if (display.close != NULL)
+		display.close();
+	display.close = NULL;
+	if (wake[0] >= 0){
+		close(wake[0]);
+		close(wake[1]);
+		wake[0] = wake[1] = -1;
+	}
+}
+
+/// Function: displayPut
+///----------------------
+/// Draws a character at the given position
+
+void displayPut(int row, int col, char ch){
+	display.put(row, col, ch);
+}
+
+/// Function: displayGet
+///----------------------
+/// Reads back the character at the given position
+
+char displayGet(int row, int col){
+	return display.get(row, col);
+}
+
+/// Function: displayPuts
+///-----------------------
+/// Draws a string starting at the given position
+
+void displayPuts(int row, int col, const char * str){
+	for (size_t i = 0; str[i] != '\0'; i++)
+		display.put(row, col + i, str[i]);
+}
+
+/// Function: displayPrint
+///------------------------
+/// Draws printf-style formatted text at the given position
+
+void displayPrint(int row, int col, const char * format, ...){
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	displayPuts(row, col, text);
+}
+
+/// Function: displayClearToEol
+///-----------------------------
+/// Blanks a row from the given column to its end
+
+void displayClearToEol(int row, int col){
+	display.clearToEol(row, col);
+}
+
+/// Function: displayRefresh
+///--------------------------
+/// Makes pending changes visible
+
+void displayRefresh(void){
+	display.flush();
+}
+
+/// Function: displayKey
+///----------------------
+/// Waits for the next key press
+
+int displayKey(void){
+	return display.key();
+}
+
+/// Function: displayInterrupt
+///----------------------------
+/// Makes any waiting displayKey, and every later one, return at once
+
+void displayInterrupt(void){
+	if (wake[1] >= 0 && write(wake[1], "", 1) < 0)
+		return; // the pipe already holds a byte, which is enough
+}
+
+/// Function: displayKeyTime
+///--------------------------
+/// When the key last returned by displayKey was read
+
+uint64_t displayKeyTime(void){
+	return keyTime;
+}
+
+/// Function: displayRows
+///-----------------------
+/// The number of rows in the selected backend
+
+int displayRows(void){
+	return display.rows;
+}
+
+/// Function: displayCols
+///-----------------------
+/// The number of columns in the selected backend
+
+int displayCols(void){
+	return display.cols;
+}
+
+/// Function: displayInteractive
+///------------------------------
+/// Whether the selected backend has a person at it
+
+bool displayInteractive(void){
+	return display.interactive;
+}
+
+/// Function: displayDump
+///-----------------------
+/// Writes the grid backend's contents as text, one line per row
+///
+/// @param fp the stream written to
+
+void displayDump(FILE * fp){
+	assert(grid != NULL);
+	for (int row = 0; row < display.rows; row++){
+		int end = display.cols;
+		while (end > 0 && grid[row * display.cols + end - 1] == ' ')
+			end--; // trailing blanks carry no information
+		fwrite(grid + row * display.cols, 1, end, fp);
+		fputc('\n', fp);
+	}
+}
@@ -0,0 +1,133 @@
+/// display.h - header file for the game's output backends
+///
+/// @author Brennan Reed
+///
+/// This is the interface the game draws through. The curses backend drives
+/// the terminal; the ANSI backend drives it directly, keeping front and
+/// back buffers and sending only the cells that changed; the grid backend
+/// renders into an in-memory character grid so the engine can run headless.
+
+#ifndef _DISPLAY_H
+#define _DISPLAY_H
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+
+/// Key codes returned by displayKey besides plain characters
+
+#define DISPLAY_KEY_NONE	(-1)	///< no key is available
+#define DISPLAY_KEY_LEFT	(-2)	///< the left arrow key
+#define DISPLAY_KEY_RIGHT	(-3)	///< the right arrow key
+
+/// Display_S structure is the table of operations a backend provides.
+
+typedef struct Display_S {
+
+    void (*put)( int row, int col, char ch ); ///< draws one character
+
+    char (*get)( int row, int col ); ///< reads one character back
+
+    void (*clearToEol)( int row, int col ); ///< blanks the rest of a row
+
+    void (*flush)( void ); ///< makes pending changes visible
+
+    int (*key)( void ); ///< waits for the next key press
+
+    void (*close)( void ); ///< releases the backend
+
+    bool interactive; ///< whether a person is at the other end
+
+    int rows; ///< number of rows in the display
+
+    int cols; ///< number of columns in the display
+
+} Display;
+
+/// openCursesDisplay - Starts curses on the terminal and selects it.
+///
+/// @return true if the terminal could be initialised
+
+bool openCursesDisplay( void );
+
+/// openAnsiDisplay - Takes over the terminal with ANSI escape sequences and
+/// selects it. Each refresh is one write() of the changed runs of cells,
+/// and its size is recorded in the HIST_FRAME_BYTES histogram.
+///
+/// @return true if stdin and stdout are a terminal that could be set up
+
+bool openAnsiDisplay( void );
+
+/// openGridDisplay - Selects an in-memory grid of the given size.
+///
+/// @param rows number of rows in the grid
+/// @param cols number of columns in the grid
+/// @return true if the grid could be allocated
+
+bool openGridDisplay( int rows, int cols );
+
+/// closeDisplay - Releases the selected backend.
+
+void closeDisplay( void );
+
+/// displayPut - Draws a character; positions off the display are ignored.
+
+void displayPut( int row, int col, char ch );
+
+/// displayGet - Reads back a character; positions off the display are blank.
+
+char displayGet( int row, int col );
+
+/// displayPuts - Draws a string starting at the given position.
+
+void displayPuts( int row, int col, const char *str );
+
+/// displayPrint - Draws printf-style formatted text at the given position.
+
+void displayPrint( int row, int col, const char *format, ... );
+
+/// displayClearToEol - Blanks a row from the given column to its end.
+
+void displayClearToEol( int row, int col );
+
+/// displayRefresh - Makes pending changes visible.
+
+void displayRefresh( void );
+
+/// displayKey - Waits for the next key press.
+///
+/// @return a character, or one of the DISPLAY_KEY_ codes
+
+int displayKey( void );
+
+/// displayInterrupt - Makes a displayKey waiting for a key, and every later
+/// one, return DISPLAY_KEY_NONE at once, so a thread reading keys can be
+/// stopped.
+
+void displayInterrupt( void );
+
+/// displayKeyTime - When the key last returned by displayKey was read.
+///
+/// @return the time in statsNow() nanoseconds, 0 if no key has been read
+
+uint64_t displayKeyTime( void );
+
+/// displayRows - the number of rows in the selected backend
+
+int displayRows( void );
+
+/// displayCols - the number of columns in the selected backend
+
+int displayCols( void );
+
+/// displayInteractive - whether the selected backend has a person at it
+
+bool displayInteractive( void );
+
+/// displayDump - Writes the grid backend's contents as text.
+///
+/// @param fp the stream written to
+/// @pre the grid backend is selected
+
+void displayDump( FILE *fp );
+
+#endif
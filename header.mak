@@ -2,4 +2,4 @@
 CXXFLAGS =	-ggdb
 CFLAGS =	-ggdb -std=c99 -Wall -Wextra -pthread
 # might use wide character data
-CLIBFLAGS =	-lm -lncursesw -pthread
+CLIBFLAGS =	-lm -lncursesw -lrt -pthread
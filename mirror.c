@@ -0,0 +1,266 @@
+/// Program: mirror.c
+///-------------------
+/// Shared-memory mirror of a running game. The render thread drawing the
+/// game writes one snapshot per frame straight into the segment under a
+/// sequence lock;
+/// the game's other threads are untouched. Readers in other processes map
+/// the segment and copy a snapshot out, retrying if the writer was in the
+/// middle of one.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "mirror.h"
+#include "clock.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// Mirror_S structure is a segment a game is mirrored into
+
+struct Mirror_S {
+
+	MirrorHeader *header; ///< the mapped segment
+
+	size_t size; ///< bytes mapped
+
+	char *name; ///< the segment's name, for removing it
+
+	MirrorMissile *slots; ///< the segment's missile slots
+
+	Shield *source; ///< the shield of the game being mirrored
+
+	MissileStore *store; ///< the missiles of the game being mirrored
+
+};
+
+/// Function: layout
+///------------------
+/// Works out where a segment's arrays are
+///
+/// @param cityColumns the number of heights in the city
+/// @param capacity the number of missile slots
+/// @param missiles where the offset of the missile slots is stored
+/// @return the segment's size in bytes
+
+static size_t layout(uint64_t cityColumns, uint64_t capacity, size_t * missiles){
+	size_t heights = sizeof(MirrorHeader) + cityColumns * sizeof(int32_t);
+	*missiles = (heights + 7) & ~(size_t)7;
+	return *missiles + capacity * sizeof(MirrorMissile);
+}
+
+/// Function: mirrorChecksum
+///--------------------------
+/// Sums up the launched missiles, as the writer does for every snapshot
+///
+/// @param missiles the missile slots
+/// @param launched the number of slots in use
+/// @return the checksum
+
+uint64_t mirrorChecksum(const MirrorMissile * missiles, uint64_t launched){
+	uint64_t sum = 0;
+	for (uint64_t i = 0; i < launched; i++)
+		sum = sum * 31 + (uint32_t)missiles[i].column * 65599u + (uint32_t)missiles[i].row * 2u + (uint32_t)missiles[i].exploded;
+	return sum;
+}
+
+/// Function: publish
+///-------------------
+/// Writes one snapshot of the game into the segment. The missiles' fields
+/// are read without the stripe locks, so a snapshot can catch a missile
+/// between two of its fields changing; it is still exactly what readers get.
+///
+/// @param mirror the open segment
+/// @param ended whether this is the game's last snapshot
+
+static void publish(Mirror * mirror, bool ended){
+	MirrorHeader * header = mirror->header;
+	MirrorMissile * slots = mirror->slots;
+	MissileStore * store = mirror->store;
+	uint64_t sequence = header->sequence; // only this thread writes it
+	__atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE); // the odd sequence is seen before any of the writes below
+	MirrorState * state = &header->state;
+	state->frame++;
+	state->published = statsNow();
+	Game * game = mirror->source->game;
+	state->gameTime = game->clock != NULL ? clockNow(game->clock) : 0;
+	size_t launched = __atomic_load_n(&store->count, __ATOMIC_RELAXED);
+	for (size_t i = 0; i < launched; i++){
+		slots[i].column = __atomic_load_n(&store->column[i], __ATOMIC_RELAXED);
+		slots[i].row = __atomic_load_n(&store->height[i], __ATOMIC_RELAXED);
+		slots[i].exploded = __atomic_load_n(&store->exploded[i], __ATOMIC_RELAXED);
+	}
+	state->launched = launched;
+	state->checksum = mirrorChecksum(slots, launched);
+	for (int kind = 0; kind < HIT_KINDS; kind++)
+		state->hits[kind] = __atomic_load_n(&game->hits[kind], __ATOMIC_RELAXED);
+	state->shieldColumn = __atomic_load_n(&mirror->source->column, __ATOMIC_RELAXED);
+	state->ended = ended;
+	__atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/// Function: mirrorOpen
+///----------------------
+/// Creates a segment and starts mirroring a game into it
+///
+/// @param name the segment's name, such as /threads
+/// @param shield the shield of the game being mirrored
+/// @param missiles the game's missiles
+/// @param heights the city's building heights
+/// @param cityColumns the number of heights
+/// @param rows the rows in the world
+/// @param columns the columns in the world
+/// @return Mirror pointer to the dynamically allocated mirror, or NULL if
+///         the segment could not be created
+
+Mirror * mirrorOpen(const char * name, Shield * shield, MissileStore * missiles,
+		const int * heights, size_t cityColumns, int rows, int columns){
+	assert(shield != NULL && missiles != NULL);
+	Mirror * new = malloc(sizeof(struct Mirror_S));
+	if (new == NULL)
+		return NULL;
+	size_t missilesAt;
+	size_t size = layout(cityColumns, missiles->capacity, &missilesAt);
+	shm_unlink(name); // a segment left by a killed game stays with whoever still maps it
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0){
+		free(new);
+		return NULL;
+	}
+	void * memory = MAP_FAILED;
+	if (ftruncate(fd, size) == 0)
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the segment
+	new->name = strdup(name);
+	if (memory == MAP_FAILED || new->name == NULL){
+		if (memory != MAP_FAILED)
+			munmap(memory, size);
+		free(new->name);
+		free(new);
+		shm_unlink(name);
+		return NULL;
+	}
+	MirrorHeader * header = memory; // ftruncate filled it with zeros
+	header->version = MIRROR_VERSION;
+	header->rows = rows;
+	header->columns = columns;
+	header->shieldRow = shield->row;
+	header->shieldWidth = strlen(shield->graphic);
+	header->cityColumns = cityColumns;
+	header->capacity = missiles->capacity;
+	int32_t * city = (int32_t *)(header + 1);
+	for (size_t i = 0; i < cityColumns; i++)
+		city[i] = heights[i];
+	new->header = header;
+	new->slots = (MirrorMissile *)((char *)memory + missilesAt);
+	new->source = shield;
+	new->store = missiles;
+	new->size = size;
+	publish(new, false);
+	__atomic_store_n(&header->magic, MIRROR_MAGIC, __ATOMIC_RELEASE); // readers may attach from here on
+	return new;
+}
+
+/// Function: mirrorPublish
+///-------------------------
+/// Writes a snapshot of the game
+///
+/// @param mirror the game's mirror
+
+void mirrorPublish(Mirror * mirror){
+	publish(mirror, false);
+}
+
+/// Function: mirrorClose
+///-----------------------
+/// Publishes the game's last snapshot, removes the segment and frees the
+/// Mirror
+///
+/// @param mirror the mirror being closed, or NULL
+
+void mirrorClose(Mirror * mirror){
+	if (mirror == NULL)
+		return;
+	publish(mirror, true);
+	munmap(mirror->header, mirror->size);
+	shm_unlink(mirror->name);
+	free(mirror->name);
+	free(mirror);
+}
+
+/// Function: mirrorAttach
+///------------------------
+/// Maps a segment for reading
+///
+/// @param name the segment's name
+/// @param view where the mapping is described
+/// @return true if the segment exists and has a header this reader understands
+
+bool mirrorAttach(const char * name, MirrorView * view){
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	void * memory = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(MirrorHeader))
+		memory = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+		return false;
+	const MirrorHeader * header = memory;
+	size_t missilesAt;
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != MIRROR_MAGIC || header->version != MIRROR_VERSION ||
+			layout(header->cityColumns, header->capacity, &missilesAt) > (size_t)info.st_size){
+		munmap(memory, info.st_size); // still being created, or by a different writer
+		return false;
+	}
+	view->header = header;
+	view->heights = (const int32_t *)(header + 1);
+	view->missiles = (const MirrorMissile *)((const char *)memory + missilesAt);
+	view->size = info.st_size;
+	return true;
+}
+
+/// Function: mirrorDetach
+///------------------------
+/// Unmaps a segment
+///
+/// @param view the mapping being released
+
+void mirrorDetach(MirrorView * view){
+	munmap((void *)view->header, view->size);
+	view->header = NULL;
+}
+
+/// Function: mirrorRead
+///----------------------
+/// Copies a consistent snapshot out of a segment. A copy is kept only if
+/// the sequence was the same even number before and after it was taken.
+///
+/// @param view the segment being read
+/// @param state where the snapshot's state is stored
+/// @param missiles where its missiles are stored
+/// @return the number of attempts the writer spoiled before one succeeded
+
+size_t mirrorRead(const MirrorView * view, MirrorState * state, MirrorMissile * missiles){
+	const MirrorHeader * header = view->header;
+	for (size_t retries = 0; ; retries++){
+		uint64_t before = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+		if ((before & 1) == 0){
+			memcpy(state, &header->state, sizeof(MirrorState));
+			uint64_t launched = state->launched <= header->capacity ? state->launched : header->capacity;
+			memcpy(missiles, view->missiles, launched * sizeof(MirrorMissile));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE); // the copies are done before the sequence is read again
+			if (__atomic_load_n(&header->sequence, __ATOMIC_RELAXED) == before)
+				return retries;
+		}
+		sched_yield(); // the writer is mid-snapshot
+	}
+}
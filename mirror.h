@@ -0,0 +1,177 @@
+/// mirror.h - header file for the game's shared-memory mirror
+///
+/// @author Brennan Reed
+///
+/// This is the interface for publishing a running game to other processes.
+/// The game mirrors its city, its missiles, its shield and its tallies into
+/// a POSIX shared-memory segment once per frame, from its render thread, so
+/// the missile and shield threads never do any of the work. The segment is
+/// guarded by a sequence lock: the writer makes the sequence odd while it
+/// writes and even again when it is done, and a reader keeps a copy only if
+/// the sequence was the same even number before and after it read. Readers
+/// take no lock of the game's and can never hold the writer up.
+
+#ifndef _MIRROR_H
+#define _MIRROR_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "occupancy.h"
+#include "threads.h"
+
+/// MIRROR_MAGIC marks a segment whose header has been filled in
+
+#define MIRROR_MAGIC 0x4d495252u
+
+/// MIRROR_VERSION changes whenever the segment's layout does
+
+#define MIRROR_VERSION 1
+
+/// MirrorMissile_S structure is one missile slot as mirrored.
+
+typedef struct MirrorMissile_S {
+
+    int32_t column; ///< the missile's column
+
+    int32_t row; ///< the missile's row
+
+    int32_t exploded; ///< 1 once the missile has stopped falling
+
+} MirrorMissile;
+
+/// MirrorState_S structure is the part of the segment that changes while
+/// the game runs; it is only consistent when read under the sequence lock.
+
+typedef struct MirrorState_S {
+
+    uint64_t frame; ///< snapshots published so far, counted from 1
+
+    uint64_t published; ///< statsNow() nanoseconds when the snapshot was taken
+
+    uint64_t gameTime; ///< the game's virtual time in microseconds
+
+    uint64_t launched; ///< missile slots in use, the rest of the array is blank
+
+    uint64_t hits[HIT_KINDS]; ///< explosions so far, by what each missile struck
+
+    int32_t shieldColumn; ///< the shield's left-most column
+
+    int32_t ended; ///< 1 in the game's last snapshot
+
+    uint64_t checksum; ///< mirrorChecksum of the missiles, to catch torn copies
+
+} MirrorState;
+
+/// MirrorHeader_S structure starts the segment. Everything but sequence and
+/// state is written once, before magic is set. The city's heights and then
+/// the missiles follow the header.
+
+typedef struct MirrorHeader_S {
+
+    uint32_t magic; ///< MIRROR_MAGIC once the rest of the header is valid
+
+    uint32_t version; ///< MIRROR_VERSION of the writer
+
+    int32_t rows; ///< rows in the world
+
+    int32_t columns; ///< columns in the world
+
+    int32_t shieldRow; ///< the shield's row
+
+    int32_t shieldWidth; ///< the shield's width
+
+    uint64_t cityColumns; ///< number of heights in the city
+
+    uint64_t capacity; ///< number of missile slots
+
+    uint64_t sequence; ///< odd while a snapshot is being written
+
+    MirrorState state; ///< the latest snapshot
+
+} MirrorHeader;
+
+/// MirrorView_S structure is a reader's mapping of a segment.
+
+typedef struct MirrorView_S {
+
+    const MirrorHeader *header; ///< the start of the mapping
+
+    const int32_t *heights; ///< the city's heights, header->cityColumns of them
+
+    const MirrorMissile *missiles; ///< the missile slots, header->capacity of them
+
+    size_t size; ///< bytes mapped
+
+} MirrorView;
+
+/// Mirror_S structure is a segment a game is mirrored into. The
+/// definition is private to mirror.c.
+
+typedef struct Mirror_S Mirror;
+
+/// mirrorOpen - Creates a segment and starts mirroring a game into it;
+/// handed to the game's renderer with renderMirror, it is written on every
+/// frame the render thread draws.
+///
+/// @param name the segment's name, such as /threads
+/// @param shield the shield of the game being mirrored
+/// @param store the game's missiles
+/// @param heights the city's building heights
+/// @param cityColumns the number of heights
+/// @param rows the rows in the world
+/// @param columns the columns in the world
+/// @return Mirror pointer to a dynamically allocated Mirror object, or NULL
+///         if the segment could not be created
+
+Mirror * mirrorOpen( const char *name, Shield *shield, MissileStore *store,
+		const int *heights, size_t cityColumns, int rows, int columns );
+
+/// mirrorPublish - Writes a snapshot of the game. Only one thread, the
+/// render thread while it runs, may write a mirror.
+///
+/// @param mirror the game's mirror
+
+void mirrorPublish( Mirror *mirror );
+
+/// mirrorClose - Publishes the game's last snapshot, marked as ended,
+/// removes the segment and frees the Mirror; readers keep their mappings.
+///
+/// @param mirror the mirror being closed, or NULL
+/// @pre the render thread no longer publishes it
+
+void mirrorClose( Mirror *mirror );
+
+/// mirrorAttach - Maps a segment for reading.
+///
+/// @param name the segment's name
+/// @param view where the mapping is described
+/// @return true if the segment exists and has a header this reader understands
+
+bool mirrorAttach( const char *name, MirrorView *view );
+
+/// mirrorDetach - Unmaps a segment.
+///
+/// @param view the mapping being released
+
+void mirrorDetach( MirrorView *view );
+
+/// mirrorRead - Copies a consistent snapshot out of a segment, retrying
+/// while the writer is in the middle of one.
+///
+/// @param view the segment being read
+/// @param state where the snapshot's state is stored
+/// @param missiles where its missiles are stored, room for header->capacity
+/// @return the number of attempts the writer spoiled before one succeeded
+
+size_t mirrorRead( const MirrorView *view, MirrorState *state, MirrorMissile *missiles );
+
+/// mirrorChecksum - Sums up the launched missiles, as the writer does for
+/// every snapshot.
+///
+/// @param missiles the missile slots
+/// @param launched the number of slots in use
+/// @return the checksum
+
+uint64_t mirrorChecksum( const MirrorMissile *missiles, uint64_t launched );
+
+#endif
@@ -0,0 +1,375 @@
+/// Program: montecarlo.c
+///-----------------------
+/// Plays batches of headless games in simulated time. Each worker thread
+/// owns a deque of games; it plays from the bottom of its own and, once
+/// that is empty, steals from the top of another's, so a worker stuck on
+/// a slow city never leaves the others idle.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "montecarlo.h"
+#include "threads.h"
+#include "config.h"
+#include "occupancy.h"
+#include "pool.h"
+#include "rng.h"
+#include "wheel.h"
+#include "batch.h"
+#include "autopilot.h"
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BATCH_ROWS	24
+#define BATCH_COLS	80
+#define LAUNCH_SPACING	1000000
+#define SHIELD_TICKS	50
+
+/// Outcome_S structure is what one game came to
+
+typedef struct Outcome_S {
+
+	size_t missiles; ///< missiles launched
+
+	size_t hits[HIT_KINDS]; ///< explosions by what each missile struck
+
+	uint64_t duration; ///< simulated microseconds until the last explosion
+
+} Outcome;
+
+/// Deque_S structure is one worker's remaining games, a range of game
+/// numbers taken from the bottom by its owner and from the top by thieves
+
+typedef struct Deque_S {
+
+	pthread_mutex_t mutex; ///< guards top and bottom
+
+	size_t top; ///< the first game left
+
+	size_t bottom; ///< one past the last game left
+
+} Deque;
+
+/// Batch_S structure is everything the workers share
+
+typedef struct Batch_S {
+
+	const BatchOptions *options; ///< the batch's settings
+
+	Config *configs; ///< the parsed config files
+
+	Outcome *outcomes; ///< one per game, fileCount * runs of them
+
+	Deque *deques; ///< one per worker
+
+	size_t workers; ///< number of workers
+
+	size_t steals; ///< games played by a worker other than the one dealt them
+
+	bool failed; ///< set when a game could not be set up
+
+} Batch;
+
+/// Worker_S structure is one worker thread's handle on the batch
+
+typedef struct Worker_S {
+
+	Batch *batch; ///< the shared batch
+
+	size_t index; ///< the worker's own deque
+
+} Worker;
+
+/// Function: steer
+///-----------------
+/// Moves a scripted shield one column toward the lowest falling missile
+///
+/// @param shield the shield being steered
+/// @param store the game's missiles
+
+static void steer(Shield * shield, MissileStore * store){
+	int lowest = -1, target = 0;
+	for (size_t id = 0; id < store->count; id++){
+		if (store->exploded[id] == false && store->height[id] > lowest){
+			lowest = store->height[id];
+			target = store->column[id];
+		}
+	}
+	int centre = shield->column + (int)strlen(shield->graphic) / 2;
+	if (lowest >= 0 && target != centre)
+		advanceShield(shield, target < centre, 0);
+}
+
+/// Function: fly
+///---------------
+/// Moves an autopilot shield one column toward the autopilot's target
+///
+/// @param shield the shield being steered
+/// @param now the simulated time in microseconds
+
+static void fly(Shield * shield, uint64_t now){
+	Autopilot * pilot = shield->game->autopilot;
+	autopilotTime(pilot, now);
+	int target = autopilotTarget(pilot, shield->column, (int)strlen(shield->graphic));
+	if (target != shield->column)
+		advanceShield(shield, target < shield->column, 0);
+}
+
+/// Function: play
+///----------------
+/// Plays one game to the end in simulated time
+///
+/// @param batch the batch the game belongs to
+/// @param game the game's number, file * runs + run
+/// @param outcome where the result is stored
+/// @return false if the game could not be set up
+
+static bool play(Batch * batch, size_t game, Outcome * outcome){
+	const BatchOptions * options = batch->options;
+	Config * config = &batch->configs[game / options->runs];
+	uint64_t seed = options->seed + game % options->runs;
+	size_t missiles = config->missiles != 0 ? config->missiles : options->density;
+	int width = ((int)config->columns > BATCH_COLS ? (int)config->columns : BATCH_COLS) + 1;
+	Occupancy * grid = createOccupancy(BATCH_ROWS, width);
+	MissileStore * store = createMissileStore(missiles);
+	TimingWheel * wheel = createWheel(missiles, 0);
+	Autopilot * pilot = options->script == SCRIPT_AUTOPILOT ?
+			createAutopilot(missiles, width, SHIELD_TICKS * TICK_US) : NULL;
+	Game state;
+	bool ready = grid != NULL && store != NULL && wheel != NULL &&
+			(options->script != SCRIPT_AUTOPILOT || pilot != NULL);
+	if (ready == true){
+		int tallest = occupancyCity(grid, config->heights, config->columns, NULL, NULL);
+		ready = initThreads(&state, BATCH_ROWS - 2, tallest, config->columns, config->defender, false, grid);
+	}
+	Shield * shield = ready == true ? createShield(&state, (config->columns / 2) + 3) : NULL;
+	if (shield == NULL){
+		if (ready == true)
+			releaseThreads(&state);
+		if (grid != NULL)
+			destroyOccupancy(grid);
+		if (store != NULL)
+			destroyMissileStore(store);
+		if (wheel != NULL)
+			destroyWheel(wheel);
+		if (pilot != NULL)
+			destroyAutopilot(pilot);
+		return false;
+	}
+	state.autopilot = pilot;
+
+	showShield(shield);
+	Rng stream;
+	for (size_t i = 0; i < missiles; i++){ // the same launches as an interactive game
+		rngSeed(&stream, seed, i);
+		int x = rngBelow(&stream, config->columns + 1);
+		createMissile(&state, store, x, i * LAUNCH_SPACING, &stream);
+		wheelSchedule(wheel, i, (uint64_t)i * LAUNCH_SPACING / TICK_US);
+	}
+	uint64_t tick = 0, shieldTick = 0, next;
+	size_t ids[BATCH_SIZE];
+	while ((next = wheelNextExpiry(wheel)) != UINT64_MAX){
+		while (options->script != SCRIPT_IDLE && shieldTick + SHIELD_TICKS <= next){
+			shieldTick += SHIELD_TICKS; // the shield keeps moving between missile steps
+			if (pilot != NULL)
+				fly(shield, shieldTick * TICK_US);
+			else
+				steer(shield, store);
+		}
+		TimerList due = { TIMER_NONE, TIMER_NONE, 0 };
+		wheelAdvance(wheel, next, &due);
+		size_t count = 0;
+		for (int32_t id = due.head; id != TIMER_NONE; id = wheel->next[id]){
+			ids[count++] = id;
+			if (count == BATCH_SIZE){
+				advanceBatch(store, ids, count, next * TICK_US);
+				count = 0;
+			}
+		}
+		advanceBatch(store, ids, count, next * TICK_US);
+		for (int32_t id = timerListPop(wheel, &due); id != TIMER_NONE; id = timerListPop(wheel, &due)){
+			if (store->exploded[id] == false)
+				wheelSchedule(wheel, id, next + nextFallDelay(&store->handles[id]) / TICK_US);
+		}
+		tick = next;
+	}
+
+	outcome->missiles = missiles;
+	memcpy(outcome->hits, state.hits, sizeof(outcome->hits));
+	outcome->duration = tick * TICK_US;
+	destroyShield(shield);
+	releaseThreads(&state);
+	if (pilot != NULL)
+		destroyAutopilot(pilot);
+	destroyWheel(wheel);
+	destroyMissileStore(store);
+	destroyOccupancy(grid);
+	return true;
+}
+
+/// Function: take
+///----------------
+/// Takes the next game from the bottom of a worker's own deque
+///
+/// @param deque the worker's deque
+/// @param game where the game's number is stored
+/// @return false if the deque is empty
+
+static bool take(Deque * deque, size_t * game){
+	pthread_mutex_lock(&deque->mutex);
+	bool found = deque->top < deque->bottom;
+	if (found == true)
+		*game = --deque->bottom;
+	pthread_mutex_unlock(&deque->mutex);
+	return found;
+}
+
+/// Function: steal
+///-----------------
+/// Takes a game from the top of another worker's deque, trying each in
+/// turn after the thief's own
+///
+/// @param batch the batch being played
+/// @param thief the worker looking for a game
+/// @param game where the game's number is stored
+/// @return false once every deque is empty
+
+static bool steal(Batch * batch, size_t thief, size_t * game){
+	for (size_t i = 1; i < batch->workers; i++){
+		Deque * victim = &batch->deques[(thief + i) % batch->workers];
+		pthread_mutex_lock(&victim->mutex);
+		bool found = victim->top < victim->bottom;
+		if (found == true)
+			*game = victim->top++;
+		pthread_mutex_unlock(&victim->mutex);
+		if (found == true){
+			__atomic_add_fetch(&batch->steals, 1, __ATOMIC_RELAXED);
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Function: work
+///----------------
+/// Main method for a batch worker, plays games until none are left
+///
+/// @param arg the Worker being run
+/// @return NULL
+
+static void *work(void * arg){
+	Worker * worker = arg;
+	Batch * batch = worker->batch;
+	size_t game;
+	while (take(&batch->deques[worker->index], &game) == true ||
+			steal(batch, worker->index, &game) == true){
+		if (play(batch, game, &batch->outcomes[game]) == false)
+			__atomic_store_n(&batch->failed, true, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+/// Function: report
+///------------------
+/// Writes the CSV row averaging one config file's games
+///
+/// @param out the stream written to
+/// @param file the config file's name
+/// @param outcomes the file's games
+/// @param runs the number of games
+
+static void report(FILE * out, const char * file, const Outcome * outcomes, size_t runs){
+	double hits[HIT_KINDS] = { 0 }, missiles = 0, total = 0;
+	uint64_t shortest = UINT64_MAX, longest = 0;
+	for (size_t r = 0; r < runs; r++){
+		missiles += outcomes[r].missiles;
+		for (int kind = 0; kind < HIT_KINDS; kind++)
+			hits[kind] += outcomes[r].hits[kind];
+		total += outcomes[r].duration;
+		if (outcomes[r].duration < shortest)
+			shortest = outcomes[r].duration;
+		if (outcomes[r].duration > longest)
+			longest = outcomes[r].duration;
+	}
+	fprintf(out, "%s,%zu,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f\n", file, runs, missiles / runs,
+			hits[HIT_BUILDING] / runs, hits[HIT_SHIELD] / runs, hits[HIT_DEBRIS] / runs,
+			hits[HIT_GROUND] / runs, missiles > 0 ? hits[HIT_SHIELD] / missiles : 0.0,
+			total / runs / 1e6, shortest / 1e6, longest / 1e6);
+}
+
+/// Function: runBatch
+///--------------------
+/// Plays every config file the requested number of times over a pool of
+/// work-stealing threads and reports the averaged outcomes
+///
+/// @param files the config file names
+/// @param fileCount the number of config files
+/// @param options the batch's settings
+/// @param out the stream the CSV is written to
+/// @return true if every file could be read and every game set up
+
+bool runBatch(char * const files[], int fileCount, const BatchOptions * options, FILE * out){
+	assert(files != NULL && fileCount > 0 && options != NULL && options->runs > 0);
+	size_t games = fileCount * options->runs;
+	size_t workers = options->workers != 0 ? options->workers : defaultPoolSize();
+	if (workers > games)
+		workers = games;
+	Batch batch = { options, calloc(fileCount, sizeof(Config)), calloc(games, sizeof(Outcome)),
+			calloc(workers, sizeof(Deque)), workers, 0, false };
+	Worker * handles = calloc(workers, sizeof(Worker));
+	pthread_t * threads = calloc(workers, sizeof(pthread_t));
+	int parsed = 0;
+	bool valid = batch.configs != NULL && batch.outcomes != NULL && batch.deques != NULL &&
+			handles != NULL && threads != NULL;
+	if (valid == false)
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+	while (valid == true && parsed < fileCount){
+		valid = parseConfig(files[parsed], &batch.configs[parsed]);
+		if (valid == true)
+			parsed++;
+	}
+
+	if (valid == true){
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < workers; i++){ // deals each worker an even share of the games
+			pthread_mutex_init(&batch.deques[i].mutex, NULL);
+			batch.deques[i].top = games * i / workers;
+			batch.deques[i].bottom = games * (i + 1) / workers;
+		}
+		for (size_t i = 0; i < workers; i++){
+			handles[i].batch = &batch;
+			handles[i].index = i;
+			pthread_create(&threads[i], NULL, &work, &handles[i]);
+		}
+		for (size_t i = 0; i < workers; i++)
+			pthread_join(threads[i], NULL);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		for (size_t i = 0; i < workers; i++)
+			pthread_mutex_destroy(&batch.deques[i].mutex);
+
+		valid = batch.failed == false;
+		if (valid == true){
+			fprintf(out, "config,runs,missiles,building_hits,shield_blocks,debris_hits,ground_hits,block_rate,"
+					"sim_seconds_mean,sim_seconds_min,sim_seconds_max\n");
+			for (int f = 0; f < fileCount; f++)
+				report(out, files[f], batch.outcomes + f * options->runs, options->runs);
+			double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+			fprintf(stderr, "batch: %zu games on %zu workers in %.3f s, %zu stolen\n",
+					games, workers, seconds, batch.steals);
+		} else
+			fprintf(stderr, "%s", "Error: out of memory.\n");
+	}
+
+	for (int f = 0; f < parsed; f++)
+		freeConfig(&batch.configs[f]);
+	free(batch.configs);
+	free(batch.outcomes);
+	free(batch.deques);
+	free(handles);
+	free(threads);
+	return valid;
+}
@@ -0,0 +1,58 @@
+/// montecarlo.h - header file for the batch game runner
+///
+/// @author Brennan Reed
+///
+/// This is the interface for running many headless games at once, to
+/// compare city designs. Every game runs in simulated time on a single
+/// thread, stepping its missiles through a timing wheel as soon as they are
+/// due instead of sleeping. Games are spread over worker threads that steal
+/// from each other once their own share runs out, and the outcomes are
+/// reported per config file.
+
+#ifndef _MONTECARLO_H
+#define _MONTECARLO_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// ShieldScript_E enumeration names the ways a batch game's shield is steered
+
+typedef enum ShieldScript_E {
+
+    SCRIPT_IDLE, ///< the shield never moves
+
+    SCRIPT_CHASE, ///< the shield moves under the lowest falling missile
+
+    SCRIPT_AUTOPILOT ///< the shield is steered by the autopilot's arrival index
+
+} ShieldScript;
+
+/// BatchOptions_S structure describes a batch of games
+
+typedef struct BatchOptions_S {
+
+    size_t runs; ///< games played per config file
+
+    size_t workers; ///< threads playing them, 0 for one per core
+
+    uint64_t seed; ///< run r of every file is seeded with seed + r
+
+    size_t density; ///< missiles launched by a config with an endless attack
+
+    ShieldScript script; ///< how the shield is steered
+
+} BatchOptions;
+
+/// runBatch - Plays every config file the requested number of times and
+/// writes a CSV row of averaged outcomes for each file.
+///
+/// @param files the config file names
+/// @param fileCount the number of config files
+/// @param options the batch's settings
+/// @param out the stream the CSV is written to
+/// @return true if every file could be read and every game set up
+
+bool runBatch( char * const files[], int fileCount, const BatchOptions *options, FILE *out );
+
+#endif
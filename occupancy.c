@@ -0,0 +1,147 @@
+/// Program: occupancy.c
+///----------------------
+/// Occupancy grid used for missile collision detection
+///
+/// @author Brennan Reed
+
+#include "occupancy.h"
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/// Function: createOccupancy
+///---------------------------
+/// Creates a new grid with every cell empty
+///
+/// @param rows number of rows in the grid
+/// @param cols number of columns in the grid
+/// @return Occupancy pointer to the dynamically allocated grid object
+
+Occupancy * createOccupancy(int rows, int cols){
+	assert(rows > 0 && cols > 0);
+	Occupancy * new = malloc(sizeof(struct Occupancy_S));
+	if (new != 0){
+		new->rows = rows;
+		new->cols = cols;
+		new->cells = calloc((size_t)rows * cols, 1); // CELL_EMPTY is zero
+		if (new->cells == NULL){
+			free(new);
+			return NULL;
+		}
+	}
+	return new;
+}
+
+/// Function: destroyOccupancy
+///----------------------------
+/// De-allocates all dynamic memory for a grid
+///
+/// @param grid pointer to the grid being freed
+
+void destroyOccupancy(Occupancy * grid){
+	assert(grid != NULL);
+	free(grid->cells);
+	free(grid);
+}
+
+/// Function: occupancyAt
+///-----------------------
+/// Looks up what fills a cell
+///
+/// @param grid the grid being queried
+/// @param row the row of the cell
+/// @param col the column of the cell
+/// @return the cell's contents, CELL_EMPTY off the grid
+
+Cell occupancyAt(const Occupancy * grid, int row, int col){
+	if (row < 0 || row >= grid->rows || col < 0 || col >= grid->cols)
+		return CELL_EMPTY;
+	return grid->cells[row * grid->cols + col];
+}
+
+/// Function: occupancySet
+///------------------------
+/// Fills a cell
+///
+/// @param grid the grid being updated
+/// @param row the row of the cell
+/// @param col the column of the cell
+/// @param cell the new contents
+
+void occupancySet(Occupancy * grid, int row, int col, Cell cell){
+	if (row < 0 || row >= grid->rows || col < 0 || col >= grid->cols)
+		return;
+	grid->cells[row * grid->cols + col] = cell;
+}
+
+/// Function: occupancySpan
+///-------------------------
+/// Fills a run of cells on one row, clipped to the grid
+///
+/// @param grid the grid being updated
+/// @param row the row of the run
+/// @param col the first column of the run
+/// @param width the number of cells in the run
+/// @param cell the new contents
+
+void occupancySpan(Occupancy * grid, int row, int col, int width, Cell cell){
+	if (row < 0 || row >= grid->rows)
+		return;
+	if (col < 0){
+		width += col;
+		col = 0;
+	}
+	if (col + width > grid->cols)
+		width = grid->cols - col;
+	if (width > 0)
+		memset(grid->cells + row * grid->cols + col, cell, width);
+}
+
+/// Function: place
+///-----------------
+/// Puts one piece of a city in the grid, and draws it if asked to
+///
+/// @param grid the grid being built on
+/// @param row the row of the piece
+/// @param col the column of the piece
+/// @param ch the character the piece is drawn with
+/// @param draw where the piece is drawn, or NULL
+/// @param context passed on to draw
+
+static void place(Occupancy * grid, int row, int col, char ch, void (*draw)(void *, int, int, char), void * context){
+	occupancySet(grid, row, col, CELL_BUILDING);
+	if (draw != NULL)
+		draw(context, row, col, ch);
+}
+
+/// Function: occupancyCity
+///-------------------------
+/// Builds a city skyline out of walls and roofs, then runs the ground on
+/// to the grid's last column
+///
+/// @param grid the grid being built on
+/// @param heights the height of the city in each column
+/// @param columns the number of columns in heights
+/// @param draw where each piece is drawn, or NULL
+/// @param context passed on to draw
+/// @return the height of the tallest building
+
+int occupancyCity(Occupancy * grid, const int * heights, size_t columns, void (*draw)(void *, int, int, char), void * context){
+	int tallest = 0, previous = 2, rows = grid->rows;
+	for (size_t i = 0; i < columns; i++){
+		int height = heights[i];
+		if (height > tallest)
+			tallest = height;
+		if (height != previous){
+			for (int x = 2; x < (height > previous ? height : previous); x++){
+				if (i > 0)
+					place(grid, rows - x, i, '|', draw, context);
+			}
+		} else
+			place(grid, rows - height, i, '_', draw, context);
+		previous = height;
+	}
+	for (int i = (int)columns - 1; i < grid->cols; i++)
+		place(grid, rows - 2, i, '_', draw, context);
+	return tallest;
+}
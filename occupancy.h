@@ -0,0 +1,113 @@
+/// occupancy.h - header file for the collision grid
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the occupancy grid. It records what fills
+/// every cell of the playing field, so a missile can find out what is
+/// below it without reading the display back.
+
+#ifndef _OCCUPANCY_H
+#define _OCCUPANCY_H
+#include <stddef.h>
+
+/// Cell enumerates what can fill one position of the playing field
+
+typedef enum Cell_E {
+
+    CELL_EMPTY,    ///< open air
+
+    CELL_BUILDING, ///< a wall, roof or the ground
+
+    CELL_SHIELD,   ///< part of the defense shield
+
+    CELL_DEBRIS    ///< the remains of an exploded missile
+
+} Cell;
+
+/// Hit enumerates what a missile struck when it exploded
+
+typedef enum Hit_E {
+
+    HIT_NONE,     ///< still falling
+
+    HIT_BUILDING, ///< a wall or roof above the ground row
+
+    HIT_SHIELD,   ///< the defense shield
+
+    HIT_DEBRIS,   ///< an earlier missile's remains
+
+    HIT_GROUND,   ///< the ground row
+
+    HIT_KINDS     ///< number of kinds, for sizing tallies
+
+} Hit;
+
+/// Occupancy_S structure holds one Cell for every row and column.
+
+typedef struct Occupancy_S {
+
+    int rows;      ///< number of rows in the grid
+
+    int cols;      ///< number of columns in the grid
+
+    unsigned char *cells; ///< rows * cols cells stored row by row
+
+} Occupancy;
+
+/// createOccupancy - Create a new grid with every cell empty.
+///
+/// @param rows number of rows in the grid
+/// @param cols number of columns in the grid
+/// @return Occupancy pointer to a dynamically allocated Occupancy object
+
+Occupancy * createOccupancy( int rows, int cols );
+
+/// destroyOccupancy - Destroy all dynamically allocated storage for a grid.
+///
+/// @param grid the object to be de-allocated
+
+void destroyOccupancy( Occupancy *grid );
+
+/// occupancyAt - What fills a cell; cells off the grid are empty.
+///
+/// @param grid the grid being queried
+/// @param row the row of the cell
+/// @param col the column of the cell
+/// @return the cell's contents
+
+Cell occupancyAt( const Occupancy *grid, int row, int col );
+
+/// occupancySet - Fills a cell; cells off the grid are ignored.
+///
+/// @param grid the grid being updated
+/// @param row the row of the cell
+/// @param col the column of the cell
+/// @param cell the new contents
+
+void occupancySet( Occupancy *grid, int row, int col, Cell cell );
+
+/// occupancySpan - Fills a run of cells on one row.
+///
+/// @param grid the grid being updated
+/// @param row the row of the run
+/// @param col the first column of the run
+/// @param width the number of cells in the run
+/// @param cell the new contents
+
+void occupancySpan( Occupancy *grid, int row, int col, int width, Cell cell );
+
+/// occupancyCity - Builds a city skyline standing on the grid's second
+/// to last row, with the ground running on across the rest of the grid.
+///
+/// @param grid the grid being built on
+/// @param heights the height of the city in each column
+/// @param columns the number of columns in heights
+/// @param draw called with the context and each piece's row, column and
+///        character so the city can be drawn too, or NULL
+/// @param context passed on to draw, such as the renderer drawing the city
+/// @return the height of the tallest building
+
+int occupancyCity( Occupancy *grid, const int *heights, size_t columns,
+        void (*draw)( void *context, int row, int col, char ch ), void *context );
+
+#endif
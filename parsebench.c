@@ -0,0 +1,86 @@
+/// Program: parsebench.c
+///-----------------------
+/// Measures config-file parse throughput on a generated cityscape
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+
+#define DEFAULT_COLUMNS	4000000
+#define DEFAULT_RUNS	5
+
+/// Function: seconds
+///-------------------
+/// Reads the monotonic clock
+///
+/// @return the current monotonic time in seconds
+
+static double seconds(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Function: generate
+///--------------------
+/// Writes a config-file with a random cityscape of the given width
+///
+/// @param path where the file is written
+/// @param columns the number of columns in the city
+/// @return the size of the file in bytes, or 0 on failure
+
+static long generate(const char * path, size_t columns){
+	FILE * fp = fopen(path, "w");
+	if (fp == NULL)
+		return 0;
+	fprintf(fp, "# generated by parsebench\nDefender\nAttacker\n0\n");
+	for (size_t i = 0; i < columns; i++)
+		fprintf(fp, "%d%c", 2 + rand() % 15, (i % 10 == 9 || i + 1 == columns) ? '\n' : ' ');
+	long size = ftell(fp);
+	fclose(fp);
+	return size;
+}
+
+/// Function: main
+///----------------
+/// Parses a generated config-file several times and reports the best run
+///
+/// @param argc number of commandline arguments
+/// @param argv optional column count and run count
+/// @return 0 if success, else EXIT_FAILURE
+
+int main(int argc, char* argv[]){
+	size_t columns = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_COLUMNS;
+	int runs = argc > 2 ? atoi(argv[2]) : DEFAULT_RUNS;
+	char path[] = "/tmp/parsebench-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0 || runs <= 0){
+		fprintf(stderr, "%s", "usage: ./parsebench [columns] [runs]\n");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	long size = generate(path, columns);
+	double best = 0;
+	Config config;
+	for (int run = 0; run < runs; run++){
+		double start = seconds();
+		if (parseConfig(path, &config) == false || config.columns != columns){
+			unlink(path);
+			fprintf(stderr, "%s", "Error: generated config-file did not parse.\n");
+			return EXIT_FAILURE;
+		}
+		double elapsed = seconds() - start;
+		freeConfig(&config);
+		if (run == 0 || elapsed < best)
+			best = elapsed;
+	}
+	unlink(path);
+	printf("columns,bytes,seconds,MB/s,Mcolumns/s\n");
+	printf("%zu,%ld,%.6f,%.1f,%.1f\n", columns, size, best, size / best / 1e6, columns / best / 1e6);
+	return 0;
+}
@@ -0,0 +1,109 @@
+/// Program: plock.c
+///------------------
+/// Mutual exclusion lock with a priority lane, used to give the shield
+/// precedence over the missiles
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "plock.h"
+#include "stats.h"
+#include <assert.h>
+
+/// Function: plockInit
+///---------------------
+/// Initializes an unheld PriorityLock at run time
+///
+/// @param lock the lock being initialized
+
+void plockInit(PriorityLock * lock){
+	assert(lock != NULL);
+	pthread_mutex_init(&lock->mutex, NULL);
+	pthread_cond_init(&lock->urgent, NULL);
+	pthread_cond_init(&lock->normal, NULL);
+	lock->held = false;
+	lock->waiting = 0;
+	lock->acquires = lock->waitNs = lock->holdNs = lock->heldSince = 0;
+}
+
+/// Function: plockDestroy
+///------------------------
+/// Releases what plockInit set up
+///
+/// @param lock the lock being destroyed
+
+void plockDestroy(PriorityLock * lock){
+	assert(lock != NULL && lock->held == false);
+	pthread_mutex_destroy(&lock->mutex);
+	pthread_cond_destroy(&lock->urgent);
+	pthread_cond_destroy(&lock->normal);
+}
+
+/// Function: plockAcquire
+///------------------------
+/// Blocks until the calling thread owns the lock. Ordinary acquirers also
+/// stand aside while any priority acquirer is waiting.
+///
+/// @param lock the lock being acquired
+/// @param priority true to go ahead of every ordinary waiter
+
+void plockAcquire(PriorityLock * lock, bool priority){
+	assert(lock != NULL);
+	uint64_t start = statsNow();
+	pthread_mutex_lock(&lock->mutex);
+	if (priority == true){
+		lock->waiting++;
+		while (lock->held == true)
+			pthread_cond_wait(&lock->urgent, &lock->mutex);
+		lock->waiting--;
+	} else {
+		if (lock->waiting > 0)
+			statsCount(STAT_LOCK_YIELDS);
+		while (lock->held == true || lock->waiting > 0)
+			pthread_cond_wait(&lock->normal, &lock->mutex);
+	}
+	lock->held = true;
+	lock->heldSince = statsNow();
+	lock->acquires++;
+	lock->waitNs += lock->heldSince - start;
+	pthread_mutex_unlock(&lock->mutex);
+	statsRecord(HIST_LOCK_WAIT, lock->heldSince - start);
+}
+
+/// Function: plockRelease
+///------------------------
+/// Releases the lock and wakes a priority waiter if there is one,
+/// otherwise an ordinary waiter
+///
+/// @param lock the lock being released
+
+void plockRelease(PriorityLock * lock){
+	assert(lock != NULL);
+	pthread_mutex_lock(&lock->mutex);
+	assert(lock->held == true);
+	lock->held = false;
+	uint64_t held = statsNow() - lock->heldSince;
+	lock->holdNs += held;
+	if (lock->waiting > 0)
+		pthread_cond_signal(&lock->urgent);
+	else
+		pthread_cond_signal(&lock->normal);
+	pthread_mutex_unlock(&lock->mutex);
+	statsRecord(HIST_LOCK_HOLD, held);
+}
+
+/// Function: plockStats
+///----------------------
+/// Reads the lock's timings so far
+///
+/// @param lock the lock being read
+/// @param stats where the timings are stored
+
+void plockStats(PriorityLock * lock, PriorityLockStats * stats){
+	assert(lock != NULL && stats != NULL);
+	pthread_mutex_lock(&lock->mutex);
+	stats->acquires = lock->acquires;
+	stats->waitNs = lock->waitNs;
+	stats->holdNs = lock->holdNs;
+	pthread_mutex_unlock(&lock->mutex);
+}
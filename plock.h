@@ -0,0 +1,91 @@
+/// plock.h - header file for the priority lock
+///
+/// @author Brennan Reed
+///
+/// This is the interface for a mutual exclusion lock with a priority lane.
+/// A thread acquiring with priority is handed the lock at the next release,
+/// ahead of every ordinary waiter. The lock also times how long threads
+/// wait for it and hold it.
+
+#ifndef _PLOCK_H
+#define _PLOCK_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/// PriorityLock_S structure is the lock's state, guarded by its own mutex.
+
+typedef struct PriorityLock_S {
+
+    pthread_mutex_t mutex; ///< guards the fields below
+
+    pthread_cond_t urgent; ///< where priority acquirers wait
+
+    pthread_cond_t normal; ///< where ordinary acquirers wait
+
+    bool held; ///< whether some thread owns the lock
+
+    int waiting; ///< number of priority acquirers waiting
+
+    uint64_t acquires; ///< number of times the lock was acquired
+
+    uint64_t waitNs; ///< total nanoseconds spent waiting to acquire
+
+    uint64_t holdNs; ///< total nanoseconds the lock was held
+
+    uint64_t heldSince; ///< when the current owner acquired it, in nanoseconds
+
+} PriorityLock;
+
+/// PriorityLockStats_S structure is a snapshot of a lock's timings.
+
+typedef struct PriorityLockStats_S {
+
+    uint64_t acquires; ///< number of times the lock was acquired
+
+    uint64_t waitNs; ///< total nanoseconds spent waiting to acquire
+
+    uint64_t holdNs; ///< total nanoseconds the lock was held
+
+} PriorityLockStats;
+
+/// PRIORITY_LOCK_INITIALIZER statically initializes an unheld PriorityLock
+
+#define PRIORITY_LOCK_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, \
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, false, 0, 0, 0, 0, 0 }
+
+/// plockInit - Initializes an unheld PriorityLock at run time.
+///
+/// @param lock the lock being initialized
+
+void plockInit( PriorityLock *lock );
+
+/// plockDestroy - Releases what plockInit set up.
+///
+/// @param lock the lock being destroyed
+/// @pre no thread owns or is waiting for the lock.
+
+void plockDestroy( PriorityLock *lock );
+
+/// plockAcquire - Blocks until the calling thread owns the lock.
+///
+/// @param lock the lock being acquired
+/// @param priority true to go ahead of every ordinary waiter
+
+void plockAcquire( PriorityLock *lock, bool priority );
+
+/// plockRelease - Releases the lock and wakes the next owner.
+///
+/// @param lock the lock being released
+/// @pre the calling thread owns the lock.
+
+void plockRelease( PriorityLock *lock );
+
+/// plockStats - Reads the lock's timings so far.
+///
+/// @param lock the lock being read
+/// @param stats where the timings are stored
+
+void plockStats( PriorityLock *lock, PriorityLockStats *stats );
+
+#endif
@@ -0,0 +1,387 @@
+/// Program: pool.c
+///-----------------
+/// Fixed-size pool of worker threads that advances missile objects
+/// when their next fall step is due. Each worker owns a lane: the column
+/// stripes assigned to it and a timing wheel for the missiles falling
+/// down them, so workers only meet when a respawned missile changes lanes.
+/// Workers sleep on the virtual clock and step one wheel tick at a time,
+/// scheduling from the tick's time rather than from when they woke, so a
+/// game plays out the same whatever speed the clock runs at and however
+/// many workers step it.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "pool.h"
+#include "wheel.h"
+#include "batch.h"
+#include "clock.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/// Lane_S structure is one worker's share of the columns
+
+typedef struct Lane_S {
+
+	pthread_mutex_t mutex; ///< guards the wheel and wake
+
+	TimingWheel *wheel; ///< the lane's missiles waiting for their next step
+
+	uint64_t wake; ///< tick the worker is sleeping until
+
+	size_t *due; ///< the ids due in the tick being stepped, in id order
+
+	struct Pool_S *pool; ///< the pool the lane belongs to
+
+} Lane;
+
+struct Pool_S {
+
+	pthread_mutex_t mutex; ///< guards waiting on done
+
+	pthread_cond_t done; ///< signalled when the last missile explodes
+
+	MissileStore *store; ///< the missiles, whose slots are the wheels' timer ids
+
+	Clock *clock; ///< the game's clock, which the workers sleep on
+
+	size_t active; ///< missiles submitted that have not exploded yet, updated atomically
+
+	bool respawn; ///< whether exploded missiles are recycled
+
+	long interval; ///< minimum microseconds between two launches of a slot
+
+	uint64_t *launched; ///< each slot's latest launch time, kept by the worker that steps the slot
+
+	bool shutdown; ///< tells the workers to exit, set under every lane's mutex
+
+	size_t workers; ///< number of worker threads, one per lane
+
+	Lane *lanes; ///< each worker's lane
+
+	pthread_t *threads; ///< the worker threads
+};
+
+/// Function: laneOf
+///------------------
+/// Finds the lane that owns a missile's column
+///
+/// @param pool the pool being searched
+/// @param missile the missile
+/// @return the lane
+
+static Lane * laneOf(Pool * pool, Missile * missile){
+	int stripe = columnStripe(missile->store->game, missile->store->column[missile->id]);
+	return &pool->lanes[stripe % pool->workers]; // neighbouring stripes go to different workers
+}
+
+/// Function: schedule
+///--------------------
+/// Puts a missile on a lane's wheel, the lane's mutex must be held
+///
+/// @param lane the lane being updated
+/// @param missile the missile being scheduled
+/// @param due virtual time in microseconds of the missile's next step
+
+static void schedule(Lane * lane, Missile * missile, uint64_t due){
+	uint64_t tick = due / TICK_US; // tick 0 starts at virtual time 0
+	wheelSchedule(lane->wheel, missile->id, tick);
+	if (tick < lane->wake){
+		lane->wake = tick;
+		clockWake(lane->pool->clock); // the worker is sleeping past it
+	}
+}
+
+/// Function: nextSpawnTime
+///-------------------------
+/// Picks a slot's next respawn time: the tick after it exploded, plus a
+/// fixed offset that spreads the slots over one interval, so slots that
+/// explode together do not all relaunch together. A slot never relaunches
+/// sooner than an interval after its previous launch. The answer depends
+/// only on the slot and the ticks it exploded in, never on which worker
+/// asked first, and the slot waits for the next tick at least: the lane it
+/// moves to may or may not have stepped the current one yet.
+///
+/// @param pool the pool respawning a missile
+/// @param id the missile's slot
+/// @param time the time of the tick the missile exploded in
+/// @return the slot's next spawn time
+
+static uint64_t nextSpawnTime(Pool * pool, size_t id, uint64_t time){
+	uint64_t interval = (uint64_t)pool->interval;
+	uint64_t spawn = time + TICK_US + interval * id / pool->store->count;
+	if (spawn < pool->launched[id] + interval)
+		spawn = pool->launched[id] + interval; // the slot's own launches keep to the rate
+	pool->launched[id] = spawn;
+	return spawn;
+}
+
+/// Function: byId
+///----------------
+/// Orders missile ids for qsort
+///
+/// @param a the first id
+/// @param b the second id
+/// @return negative, zero or positive as a is below, equal to or above b
+
+static int byId(const void * a, const void * b){
+	size_t left = *(const size_t *)a, right = *(const size_t *)b;
+	return (left > right) - (left < right);
+}
+
+/// Function: retire
+///------------------
+/// Counts a missile that will not fall again, waking poolWait after the last
+///
+/// @param pool the pool the missile belonged to
+
+static void retire(Pool * pool){
+	if (__atomic_sub_fetch(&pool->active, 1, __ATOMIC_ACQ_REL) == 0){
+		pthread_mutex_lock(&pool->mutex);
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
+
+/// Function: work
+///----------------
+/// Main method for a worker thread. Sleeps until the next tick on its
+/// lane is due, advances every missile due then one row as a batch, and
+/// puts them back on the wheel with new random delays from that tick.
+/// Exits once the pool shuts down or the clock is cancelled. A respawned missile that lands in
+/// another lane's columns is handed over to that lane.
+///
+/// @param arg the worker's Lane declared as void* for pthread operability
+/// @return NULL
+
+static void *work(void *arg){
+	Lane * lane = arg;
+	Pool * pool = lane->pool;
+	MissileStore * store = pool->store;
+	TimingWheel * wheel = lane->wheel;
+	Clock * clock = pool->clock;
+	pthread_mutex_lock(&lane->mutex);
+	while (pool->shutdown == false && clockCancelled(clock) == false){
+		uint64_t due = wheelNextExpiry(wheel);
+		uint64_t deadline = due == UINT64_MAX ? CLOCK_NEVER : due * TICK_US;
+		if (deadline > clockNow(clock)){
+			uint64_t epoch = clockEpoch(clock); // read under the mutex, so no wake is missed
+			lane->wake = due;
+			pthread_mutex_unlock(&lane->mutex);
+			clockSleep(clock, deadline, epoch);
+			pthread_mutex_lock(&lane->mutex);
+			continue;
+		}
+		TimerList batch = { TIMER_NONE, TIMER_NONE, 0 };
+		wheelAdvance(wheel, due, &batch); // one tick at a time, even when behind
+		lane->wake = 0; // awake, so nobody needs to signal
+		pthread_mutex_unlock(&lane->mutex);
+
+		size_t count = 0;
+		for (int32_t id = batch.head; id != TIMER_NONE; id = wheel->next[id]) // the batch's links belong to this worker
+			lane->due[count++] = id;
+		qsort(lane->due, count, sizeof(size_t), &byId); // the wheel's order depends on who scheduled first
+		for (size_t first = 0; first < count; first += BATCH_SIZE)
+			advanceBatch(store, lane->due + first, count - first < BATCH_SIZE ? count - first : BATCH_SIZE, deadline);
+
+		TimerList moving = { TIMER_NONE, TIMER_NONE, 0 }; // respawns owned by other lanes
+		pthread_mutex_lock(&lane->mutex);
+		uint64_t time = deadline;
+		for (size_t i = 0; i < count; i++){
+			int32_t id = lane->due[i];
+			Missile * missile = &store->handles[id];
+			if (store->exploded[id] == false)
+				schedule(lane, missile, time + nextFallDelay(missile));
+			else if (pool->respawn == true){ // the slot starts over at the next spawn time
+				resetMissile(missile);
+				if (laneOf(pool, missile) == lane)
+					schedule(lane, missile, nextSpawnTime(pool, id, time));
+				else {
+					wheel->next[id] = TIMER_NONE;
+					if (moving.tail == TIMER_NONE)
+						moving.head = id;
+					else
+						wheel->next[moving.tail] = id;
+					moving.tail = id;
+				}
+			} else
+				retire(pool);
+		}
+		pthread_mutex_unlock(&lane->mutex);
+
+		for (int32_t id = moving.head; id != TIMER_NONE; ){ // one lane lock at a time, so lanes never deadlock
+			int32_t following = wheel->next[id];
+			Missile * missile = &store->handles[id];
+			Lane * owner = laneOf(pool, missile);
+			pthread_mutex_lock(&owner->mutex);
+			schedule(owner, missile, nextSpawnTime(pool, id, time));
+			pthread_mutex_unlock(&owner->mutex);
+			id = following;
+		}
+		pthread_mutex_lock(&lane->mutex);
+	}
+	pthread_mutex_unlock(&lane->mutex);
+	if (clockCancelled(clock) == true){ // poolWait gives up on the missiles still falling
+		pthread_mutex_lock(&pool->mutex);
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	clockLeave(clock);
+	return NULL;
+}
+
+/// Function: defaultPoolSize
+///---------------------------
+/// The number of workers used when none is requested
+///
+/// @return the number of online processors, at least 1
+
+size_t defaultPoolSize(void){
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (size_t)cores : 1;
+}
+
+/// Function: createPool
+///----------------------
+/// Creates a new pool and starts one worker thread per lane. The workers
+/// and the caller join the clock, so in fast mode time holds still until
+/// the caller waits on the pool. Pools of different games keep to their
+/// own games' clocks, so any number may run at once.
+///
+/// @param workers the number of worker threads, 0 means defaultPoolSize()
+/// @param store the store holding every missile the pool may drive
+/// @return Pool pointer to the dynamically allocated pool object, NULL if
+///         out of memory
+
+Pool * createPool(size_t workers, MissileStore * store){
+	assert(store != NULL && store->game != NULL && store->game->clock != NULL);
+	Pool * new = malloc(sizeof(struct Pool_S));
+	if (new == NULL)
+		return NULL;
+	if (workers == 0)
+		workers = defaultPoolSize();
+	new->lanes = calloc(workers, sizeof(Lane));
+	new->threads = calloc(workers, sizeof(pthread_t));
+	new->launched = calloc(store->capacity > 0 ? store->capacity : 1, sizeof(uint64_t));
+	bool valid = new->lanes != NULL && new->threads != NULL && new->launched != NULL;
+	for (size_t i = 0; valid == true && i < workers; i++){
+		new->lanes[i].wheel = createWheel(store->capacity, 0);
+		new->lanes[i].due = calloc(store->capacity > 0 ? store->capacity : 1, sizeof(size_t));
+		valid = new->lanes[i].wheel != NULL && new->lanes[i].due != NULL;
+	}
+	if (valid == false){
+		for (size_t i = 0; new->lanes != NULL && i < workers; i++){
+			if (new->lanes[i].wheel != NULL)
+				destroyWheel(new->lanes[i].wheel);
+			free(new->lanes[i].due);
+		}
+		free(new->lanes);
+		free(new->threads);
+		free(new->launched);
+		free(new);
+		return NULL;
+	}
+	pthread_mutex_init(&new->mutex, NULL);
+	pthread_cond_init(&new->done, NULL);
+	for (size_t i = 0; i < workers; i++){
+		pthread_mutex_init(&new->lanes[i].mutex, NULL);
+		new->lanes[i].wake = UINT64_MAX;
+		new->lanes[i].pool = new;
+	}
+	new->store = store;
+	new->clock = store->game->clock;
+	new->active = 0;
+	new->respawn = false;
+	new->interval = 0;
+	new->shutdown = false;
+	new->workers = workers;
+	for (size_t i = 0; i <= workers; i++)
+		clockJoin(new->clock); // each worker leaves as it exits, the caller in poolWait
+	for (size_t i = 0; i < workers; i++)
+		pthread_create(&new->threads[i], NULL, &work, &new->lanes[i]);
+	return new;
+}
+
+/// Function: poolSubmit
+///----------------------
+/// Schedules a missile to start falling once its delay has passed,
+/// counted from the start of the clock
+///
+/// @param pool the pool that will drive the missile
+/// @param missile the missile being scheduled
+
+void poolSubmit(Pool * pool, Missile * missile){
+	assert(pool != NULL);
+	assert(missile != NULL && missile->store == pool->store);
+	__atomic_add_fetch(&pool->active, 1, __ATOMIC_RELAXED);
+	Lane * lane = laneOf(pool, missile);
+	pthread_mutex_lock(&lane->mutex);
+	pool->launched[missile->id] = pool->store->delay[missile->id];
+	schedule(lane, missile, pool->store->delay[missile->id]);
+	pthread_mutex_unlock(&lane->mutex);
+}
+
+/// Function: poolRespawn
+///-----------------------
+/// Recycles each missile as soon as it explodes instead of retiring it
+///
+/// @param pool the pool being configured
+/// @param interval minimum time in microseconds between two launches of a slot
+/// @pre no missile has been submitted yet.
+
+void poolRespawn(Pool * pool, long interval){
+	assert(pool != NULL);
+	pool->interval = interval;
+	pool->respawn = true; // the workers read it once a submitted missile wakes them
+}
+
+/// Function: poolWait
+///--------------------
+/// Blocks until every submitted missile has exploded or the clock is
+/// cancelled, letting fast mode's time move while it waits
+///
+/// @param pool the pool being waited on
+
+void poolWait(Pool * pool){
+	assert(pool != NULL);
+	clockLeave(pool->clock);
+	pthread_mutex_lock(&pool->mutex);
+	while (__atomic_load_n(&pool->active, __ATOMIC_ACQUIRE) > 0 && clockCancelled(pool->clock) == false)
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+	clockJoin(pool->clock);
+}
+
+/// Function: destroyPool
+///-----------------------
+/// Stops the worker threads and de-allocates the pool
+///
+/// @param pool the object to be de-allocated
+
+void destroyPool(Pool * pool){
+	assert(pool != NULL);
+	for (size_t i = 0; i < pool->workers; i++){
+		pthread_mutex_lock(&pool->lanes[i].mutex);
+		pool->shutdown = true;
+		pthread_mutex_unlock(&pool->lanes[i].mutex);
+	}
+	clockWake(pool->clock);
+	clockLeave(pool->clock); // the caller's share, taken in createPool
+	for (size_t i = 0; i < pool->workers; i++)
+		pthread_join(pool->threads[i], NULL); // waits for the workers to finish
+	for (size_t i = 0; i < pool->workers; i++){
+		pthread_mutex_destroy(&pool->lanes[i].mutex);
+		destroyWheel(pool->lanes[i].wheel);
+		free(pool->lanes[i].due);
+	}
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->done);
+	free(pool->lanes);
+	free(pool->threads);
+	free(pool->launched);
+	free(pool);
+}
@@ -0,0 +1,72 @@
+/// pool.h - header file for the missile worker pool
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the fixed-size pool of worker threads that
+/// drives any number of missile objects through advance(). Steps are
+/// scheduled on a timing wheel, so wakeups scale with ticks, not missiles,
+/// and the workers sleep on the game's clock, which must be started first.
+
+#ifndef _POOL_H
+#define _POOL_H
+#include <stddef.h>
+#include "threads.h"
+
+/// Pool_S structure is the scheduler; each worker thread owns the missiles
+/// in its share of the column stripes. The definition is private to pool.c.
+
+typedef struct Pool_S Pool;
+
+/// defaultPoolSize - the number of workers used when none is requested
+///
+/// @return the number of online processors, at least 1
+
+size_t defaultPoolSize( void );
+
+/// createPool - Create a new pool and start its worker threads. The caller
+/// holds the clock's time back until it calls poolWait, so its submissions
+/// are all in place before a fast clock moves. Each pool sleeps on its own
+/// game's clock, so pools of different games may run at the same time.
+///
+/// @param workers the number of worker threads, 0 means defaultPoolSize()
+/// @param store the store holding every missile the pool may drive
+/// @return Pool pointer to a dynamically allocated Pool object, NULL if
+///         out of memory
+/// @pre a missile has been created in the store, which ties it to its game
+
+Pool * createPool( size_t workers, MissileStore *store );
+
+/// poolSubmit - Schedules a missile to start falling once its delay, counted
+/// from the clock's start, passes.
+///
+/// @param pool the pool that will drive the missile
+/// @param missile the missile being scheduled
+/// @pre missile cannot be NULL and must not already be scheduled.
+
+void poolSubmit( Pool *pool, Missile *missile );
+
+/// poolRespawn - Recycles each missile instead of retiring it once it
+/// explodes, so as many missiles stay in flight as there are slots. Slot i
+/// relaunches i / slots of an interval after the tick it exploded in, but
+/// no sooner than an interval after its previous launch, so the schedule
+/// is the same whatever the number of workers.
+///
+/// @param pool the pool being configured
+/// @param interval minimum time in microseconds between two launches of a slot
+
+void poolRespawn( Pool *pool, long interval );
+
+/// poolWait - Blocks until every submitted missile has exploded or the clock
+/// is cancelled, letting the clock's time move meanwhile.
+///
+/// @param pool the pool being waited on
+
+void poolWait( Pool *pool );
+
+/// destroyPool - Stops the workers and frees the pool.
+///
+/// @param pool the object to be de-allocated
+
+void destroyPool( Pool *pool );
+
+#endif
@@ -0,0 +1,286 @@
+/// Program: record.c
+///-------------------
+/// Binary event log of a game session, and the reader that replays it.
+/// Records are varint-encoded and timed relative to the previous record,
+/// so a typical step costs three bytes.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "record.h"
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define RECORD_MAGIC	"MSLG"
+#define RECORD_VERSION	1
+#define RECORD_BUFFER	(64 * 1024)
+
+/// Replay_S structure is an open log being read back
+
+struct Replay_S {
+
+	FILE *fp; ///< the log
+
+	uint64_t time; ///< microseconds since recording began, as of the last record
+
+};
+
+/// Recorder_S structure is a log being appended to
+
+struct Recorder_S {
+
+	FILE *fp; ///< the log
+
+	pthread_mutex_t lock; ///< orders spawns against the stripe locks' events
+
+	Clock *clock; ///< the clock of the game being recorded
+
+	uint64_t start; ///< when recording began, in clockNow() microseconds
+
+	uint64_t last; ///< microseconds since start of the last record
+
+};
+
+/// Function: putVarint
+///---------------------
+/// Writes an unsigned integer seven bits at a time, low bits first
+///
+/// @param value the integer being written
+/// @param fp the stream written to
+
+static void putVarint(uint64_t value, FILE * fp){
+	while (value >= 0x80){
+		putc((value & 0x7f) | 0x80, fp);
+		value >>= 7;
+	}
+	putc(value, fp);
+}
+
+/// Function: getVarint
+///---------------------
+/// Reads an integer written by putVarint
+///
+/// @param value where the integer is stored
+/// @param fp the stream read from
+/// @return false at the end of the stream
+
+static bool getVarint(uint64_t * value, FILE * fp){
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7){
+		int byte = getc(fp);
+		if (byte == EOF)
+			return false;
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false; // longer than any value this file writes
+}
+
+/// Function: append
+///------------------
+/// Appends one record, timed against the previous one
+///
+/// @param log the log being appended to
+/// @param kind what happened
+/// @param fields the kind's fields
+/// @param count number of fields
+
+static void append(Recorder * log, RecordKind kind, const uint64_t * fields, int count){
+	pthread_mutex_lock(&log->lock);
+	uint64_t now = clockNow(log->clock) - log->start;
+	if (now < log->last)
+		now = log->last;
+	putc(kind, log->fp);
+	putVarint(now - log->last, log->fp);
+	for (int i = 0; i < count; i++)
+		putVarint(fields[i], log->fp);
+	log->last = now;
+	pthread_mutex_unlock(&log->lock);
+}
+
+/// Function: recordOpen
+///----------------------
+/// Starts appending every game event to a new log
+///
+/// @param path the log's file name, replaced if it exists
+/// @param header the game being recorded
+/// @param clock the clock of the game being recorded, records are timed by it
+/// @return Recorder pointer to the dynamically allocated log, or NULL if
+///         the file could not be created
+
+Recorder * recordOpen(const char * path, const RecordHeader * header, Clock * clock){
+	assert(clock != NULL);
+	Recorder * new = malloc(sizeof(struct Recorder_S));
+	if (new == NULL)
+		return NULL;
+	FILE * fp = fopen(path, "wb");
+	if (fp == NULL){
+		free(new);
+		return NULL;
+	}
+	setvbuf(fp, NULL, _IOFBF, RECORD_BUFFER);
+	fwrite(RECORD_MAGIC, 1, 4, fp);
+	putc(RECORD_VERSION, fp);
+	putVarint(header->seed, fp);
+	putVarint(header->rows, fp);
+	putVarint(header->columns, fp);
+	putVarint(header->missiles, fp);
+	putc(header->endless, fp);
+	new->fp = fp;
+	pthread_mutex_init(&new->lock, NULL);
+	new->clock = clock;
+	new->start = clockNow(clock);
+	new->last = 0;
+	return new;
+}
+
+/// Function: recordClose
+///-----------------------
+/// Writes out buffered records, closes the log and frees the Recorder
+///
+/// @param log the log being closed, or NULL
+
+void recordClose(Recorder * log){
+	if (log == NULL)
+		return;
+	fclose(log->fp);
+	pthread_mutex_destroy(&log->lock);
+	free(log);
+}
+
+/// Function: recordSpawn
+///-----------------------
+/// Logs a missile slot launching
+
+void recordSpawn(Recorder * log, size_t id, int column){
+	if (log == NULL) // the usual case costs no lock
+		return;
+	uint64_t fields[] = { id, column };
+	append(log, RECORD_SPAWN, fields, 2);
+}
+
+/// Function: recordStep
+///----------------------
+/// Logs a missile falling a row
+
+void recordStep(Recorder * log, size_t id){
+	if (log == NULL)
+		return;
+	uint64_t fields[] = { id };
+	append(log, RECORD_STEP, fields, 1);
+}
+
+/// Function: recordExplode
+///-------------------------
+/// Logs a missile exploding
+
+void recordExplode(Recorder * log, size_t id, int row){
+	if (log == NULL)
+		return;
+	uint64_t fields[] = { id, row };
+	append(log, RECORD_EXPLODE, fields, 2);
+}
+
+/// Function: recordShield
+///------------------------
+/// Logs the shield moving
+
+void recordShield(Recorder * log, int column){
+	if (log == NULL)
+		return;
+	uint64_t fields[] = { column };
+	append(log, RECORD_SHIELD, fields, 1);
+}
+
+/// Function: createReplay
+///------------------------
+/// Opens a log and reads its header
+///
+/// @param path the log's file name
+/// @param header where the header is stored
+/// @return Replay pointer to a dynamically allocated Replay object, or NULL
+
+Replay * createReplay(const char * path, RecordHeader * header){
+	FILE * fp = fopen(path, "rb");
+	if (fp == NULL)
+		return NULL;
+	char magic[4];
+	uint64_t rows, columns, missiles;
+	int endless;
+	if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, RECORD_MAGIC, 4) != 0 ||
+			getc(fp) != RECORD_VERSION || getVarint(&header->seed, fp) == false ||
+			getVarint(&rows, fp) == false || getVarint(&columns, fp) == false ||
+			getVarint(&missiles, fp) == false || (endless = getc(fp)) == EOF){
+		fclose(fp);
+		return NULL;
+	}
+	header->rows = rows;
+	header->columns = columns;
+	header->missiles = missiles;
+	header->endless = endless != 0;
+	Replay * new = malloc(sizeof(struct Replay_S));
+	if (new == NULL){
+		fclose(fp);
+		return NULL;
+	}
+	setvbuf(fp, NULL, _IOFBF, RECORD_BUFFER);
+	new->fp = fp;
+	new->time = 0;
+	return new;
+}
+
+/// Function: replayNext
+///----------------------
+/// Reads the next record
+///
+/// @param replay the log being read
+/// @param record where the record is stored
+/// @return false at the end of the log, or at a truncated record
+
+bool replayNext(Replay * replay, Record * record){
+	assert(replay != NULL);
+	int kind = getc(replay->fp);
+	uint64_t delta, id = 0, value = 0;
+	if (kind == EOF || getVarint(&delta, replay->fp) == false)
+		return false;
+	switch (kind){
+		case RECORD_SPAWN:
+		case RECORD_EXPLODE:
+			if (getVarint(&id, replay->fp) == false || getVarint(&value, replay->fp) == false)
+				return false;
+			break;
+		case RECORD_STEP:
+			if (getVarint(&id, replay->fp) == false)
+				return false;
+			break;
+		case RECORD_SHIELD:
+			if (getVarint(&value, replay->fp) == false)
+				return false;
+			break;
+		default:
+			return false; // not a record this version writes
+	}
+	replay->time += delta;
+	record->kind = kind;
+	record->time = replay->time;
+	record->id = id;
+	record->value = value;
+	return true;
+}
+
+/// Function: destroyReplay
+///-------------------------
+/// Closes a log and frees the Replay object
+///
+/// @param replay the object to be de-allocated
+
+void destroyReplay(Replay * replay){
+	assert(replay != NULL);
+	fclose(replay->fp);
+	free(replay);
+}
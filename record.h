@@ -0,0 +1,146 @@
+/// record.h - header file for session recording and replay
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the game's binary event log. While recording,
+/// every spawn, missile step, explosion and shield move is appended in the
+/// order it happened under the stripe locks, each stamped with the virtual
+/// time since recording began. Replaying the log in that order reproduces
+/// the game.
+///
+/// The file is a header followed by records. The header is the bytes
+/// "MSLG", a version byte, then the seed, world rows, city columns, missile
+/// slots and endless flag as varints. Each record is a kind byte, the
+/// microseconds since the previous record as a varint, and then the
+/// kind's fields as varints.
+
+#ifndef _RECORD_H
+#define _RECORD_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "clock.h"
+
+/// RecordKind_E enumeration names the events in a log
+
+typedef enum RecordKind_E {
+
+    RECORD_SPAWN = 1, ///< a missile slot launched: id, column
+
+    RECORD_STEP, ///< a missile fell a row: id
+
+    RECORD_EXPLODE, ///< a missile exploded: id, row
+
+    RECORD_SHIELD ///< the shield moved: column
+
+} RecordKind;
+
+/// RecordHeader_S structure describes the game a log was recorded from.
+
+typedef struct RecordHeader_S {
+
+    uint64_t seed; ///< the game seed
+
+    int rows; ///< number of rows in the world
+
+    size_t columns; ///< number of columns in the config's city
+
+    size_t missiles; ///< number of missile slots
+
+    bool endless; ///< whether the attack was endless
+
+} RecordHeader;
+
+/// Record_S structure is one event read back from a log.
+
+typedef struct Record_S {
+
+    RecordKind kind; ///< what happened
+
+    uint64_t time; ///< microseconds since recording began
+
+    size_t id; ///< the missile's slot, for missile events
+
+    int value; ///< the column of a spawn or shield move, or the row of an explosion
+
+} Record;
+
+/// Recorder_S structure is a log being written. The definition is private
+/// to record.c.
+
+typedef struct Recorder_S Recorder;
+
+/// Replay_S structure is an open log being read back
+
+typedef struct Replay_S Replay;
+
+/// recordOpen - Starts appending every event of a game to a new log.
+///
+/// @param path the log's file name, replaced if it exists
+/// @param header the game being recorded
+/// @param clock the clock of the game being recorded, records are timed by it
+/// @return Recorder pointer to a dynamically allocated Recorder object, or
+///         NULL if the file could not be created
+
+Recorder * recordOpen( const char *path, const RecordHeader *header, Clock *clock );
+
+/// recordClose - Writes out buffered records, closes the log and frees it.
+///
+/// @param log the log being closed, or NULL
+
+void recordClose( Recorder *log );
+
+/// recordSpawn - Logs a missile slot launching.
+///
+/// @param log the game's log, or NULL when it is not recorded
+/// @param id the missile's slot
+/// @param column the column it falls down
+
+void recordSpawn( Recorder *log, size_t id, int column );
+
+/// recordStep - Logs a missile falling a row.
+///
+/// @param log the game's log, or NULL when it is not recorded
+/// @param id the missile's slot
+
+void recordStep( Recorder *log, size_t id );
+
+/// recordExplode - Logs a missile exploding.
+///
+/// @param log the game's log, or NULL when it is not recorded
+/// @param id the missile's slot
+/// @param row the row it exploded on
+
+void recordExplode( Recorder *log, size_t id, int row );
+
+/// recordShield - Logs the shield moving.
+///
+/// @param log the game's log, or NULL when it is not recorded
+/// @param column the shield's new column
+
+void recordShield( Recorder *log, int column );
+
+/// createReplay - Opens a log and reads its header.
+///
+/// @param path the log's file name
+/// @param header where the header is stored
+/// @return Replay pointer to a dynamically allocated Replay object, or
+///         NULL if the file could not be read or is not a log
+
+Replay * createReplay( const char *path, RecordHeader *header );
+
+/// replayNext - Reads the next record.
+///
+/// @param replay the log being read
+/// @param record where the record is stored
+/// @return false at the end of the log, or at a truncated record
+
+bool replayNext( Replay *replay, Record *record );
+
+/// destroyReplay - Closes a log and frees the Replay object.
+///
+/// @param replay the object to be de-allocated
+
+void destroyReplay( Replay *replay );
+
+#endif
@@ -0,0 +1,537 @@
+/// Program: render.c
+///-------------------
+/// Render thread that consumes game events from a lock-free ring and
+/// refreshes the display at a capped frame rate. Events update a scene as
+/// wide as the world; the display shows a viewport of it that follows the
+/// shield, with on-screen text layered on top. Each game that is drawn has
+/// a renderer of its own; games that are not drawn pass none around. When
+/// missile events have been dropped, the scene is rebuilt from the game's
+/// state, so no missile is left drawn where it no longer is.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "render.h"
+#include "display.h"
+#include "stats.h"
+#include "mirror.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#define KEYS_PER_FRAME	64
+
+/// Renderer_S structure is one game's scene and the thread drawing it
+
+struct Renderer_S {
+
+	EventRing *ring; ///< events published since the last frame, NULL while stopped
+
+	RingStats finalStats; ///< the ring's counters when it was destroyed
+
+	pthread_t thread; ///< the render thread
+
+	long frameTime; ///< nanoseconds between frames
+
+	bool rendering; ///< whether the render thread is consuming, read and written atomically
+
+	pthread_mutex_t frameLock; ///< guards stopping rendering
+
+	pthread_cond_t frameCond; ///< cuts the wait for the next frame short when rendering stops
+
+	Mirror *mirror; ///< written once per frame, NULL if the game is not mirrored, read atomically
+
+	MissileStore *store; ///< the game's missiles the scene is repaired from, NULL if none, read atomically
+
+	size_t repaired; ///< dropped events the scene has been repaired after
+
+	char *scene; ///< every cell of the world, sceneRows * sceneCols
+
+	char *scenery; ///< the city alone, as sceneSet left it
+
+	int sceneRows; ///< rows in the world
+
+	int sceneCols; ///< columns in the world
+
+	char *overlay; ///< on-screen text, one cell per display cell, '\0' where clear
+
+	int viewRows; ///< rows in the display
+
+	int viewCols; ///< columns in the display
+
+	int offset; ///< world column shown in the display's first column
+
+	int shieldRow; ///< the row the shield was last drawn on
+
+	int shieldCol; ///< the column the shield was last drawn at
+
+	const char *shieldGraphic; ///< the shield's graphic, NULL until it is drawn
+
+};
+
+static Renderer * drawing; // the renderer whose thread owns the display, NULL if none
+
+/// Function: putCell
+///-------------------
+/// Changes one cell of the scene, drawing it if it is in the viewport
+/// and not covered by text
+///
+/// @param r the renderer
+/// @param row the cell's row
+/// @param col the cell's world column
+/// @param ch the new contents
+
+static void putCell(Renderer * r, int row, int col, char ch){
+	if (row < 0 || row >= r->sceneRows || col < 0 || col >= r->sceneCols)
+		return;
+	r->scene[row * r->sceneCols + col] = ch;
+	int x = col - r->offset;
+	if (row < r->viewRows && x >= 0 && x < r->viewCols && r->overlay[row * r->viewCols + x] == '\0')
+		displayPut(row, x, ch);
+}
+
+/// Function: drawViewport
+///------------------------
+/// Redraws every cell of the display from the scene and the text above it;
+/// the cost depends only on the display's size
+///
+/// @param r the renderer
+
+static void drawViewport(Renderer * r){
+	for (int row = 0; row < r->viewRows; row++){
+		for (int x = 0; x < r->viewCols; x++){
+			char ch = r->overlay[row * r->viewCols + x];
+			if (ch == '\0')
+				ch = (row < r->sceneRows && r->offset + x < r->sceneCols) ?
+						r->scene[row * r->sceneCols + r->offset + x] : ' ';
+			displayPut(row, x, ch);
+		}
+	}
+}
+
+/// Function: follow
+///------------------
+/// Scrolls the viewport when the shield gets within a quarter of the
+/// display's width of either edge, centring the shield again
+///
+/// @param r the renderer
+/// @param col the shield's world column
+/// @param width the shield's width
+/// @return true if the viewport moved
+
+static bool follow(Renderer * r, int col, int width){
+	int margin = r->viewCols / 4;
+	if (col >= r->offset + margin && col + width <= r->offset + r->viewCols - margin)
+		return false;
+	int target = col + width / 2 - r->viewCols / 2;
+	if (target > r->sceneCols - r->viewCols)
+		target = r->sceneCols - r->viewCols;
+	if (target < 0)
+		target = 0;
+	if (target == r->offset)
+		return false;
+	r->offset = target;
+	return true;
+}
+
+/// Function: apply
+///-----------------
+/// Draws one event on the display
+///
+/// @param r the renderer
+/// @param event the event being drawn
+
+static void apply(Renderer * r, const Event * event){
+	switch (event->kind){
+		case EVENT_MISSILE_MOVED:
+			putCell(r, event->from, event->col, ' ');
+			putCell(r, event->row, event->col, event->ch);
+			break;
+		case EVENT_MISSILE_EXPLODED:
+			for (int row = event->from; row < event->row; row++)
+				putCell(r, row, event->col, ' '); // every row it fell through
+			putCell(r, event->row, event->col, '?');
+			putCell(r, event->row + 1, event->col, '*');
+			break;
+		case EVENT_SHIELD_MOVED:{
+			int width = strlen(event->text);
+			for (int i = 0; i < width; i++)
+				putCell(r, event->row, event->from + i, ' ');
+			for (int i = 0; i < width; i++)
+				putCell(r, event->row, event->col + i, event->text[i]);
+			r->shieldRow = event->row;
+			r->shieldCol = event->col;
+			r->shieldGraphic = event->text;
+			if (follow(r, event->col, width) == true)
+				drawViewport(r);
+			break;
+		}
+		case EVENT_TEXT:
+			for (int i = 0; event->text[i] != '\0' && event->col + i < r->viewCols; i++){
+				if (event->row >= 0 && event->row < r->viewRows && event->col + i >= 0)
+					r->overlay[event->row * r->viewCols + event->col + i] = event->text[i];
+			}
+			displayPuts(event->row, event->col, event->text);
+			free((char *)event->text);
+			break;
+	}
+}
+
+/// Function: repair
+///------------------
+/// Rebuilds the scene from the city, the collision grid, the shield and the
+/// falling missiles, then redraws the display. Dropped missile events would
+/// otherwise leave missiles drawn where they no longer are. Debris is drawn
+/// as an explosion leaves it, with its flash below it unless that is the
+/// shield's row, which the shield wipes as it moves.
+///
+/// @param r the renderer
+
+static void repair(Renderer * r){
+	MissileStore * store = __atomic_load_n(&r->store, __ATOMIC_ACQUIRE);
+	if (store == NULL)
+		return;
+	const Occupancy * grid = store->game->grid;
+	memcpy(r->scene, r->scenery, (size_t)r->sceneRows * r->sceneCols);
+	for (int row = 0; row < r->sceneRows; row++){
+		for (int col = 0; col < r->sceneCols; col++){
+			if (occupancyAt(grid, row, col) != CELL_DEBRIS)
+				continue;
+			r->scene[row * r->sceneCols + col] = '?';
+			if (row + 1 < r->sceneRows && row + 1 != r->shieldRow && occupancyAt(grid, row + 1, col) != CELL_DEBRIS)
+				r->scene[(row + 1) * r->sceneCols + col] = '*';
+		}
+	}
+	if (r->shieldGraphic != NULL){
+		for (int i = 0; r->shieldGraphic[i] != '\0'; i++){
+			if (r->shieldRow < r->sceneRows && r->shieldCol + i < r->sceneCols)
+				r->scene[r->shieldRow * r->sceneCols + r->shieldCol + i] = r->shieldGraphic[i];
+		}
+	}
+	size_t count = __atomic_load_n(&store->count, __ATOMIC_RELAXED);
+	for (size_t id = 0; id < count; id++){ // the workers may be moving them, like the mirror reads them
+		int row = __atomic_load_n(&store->height[id], __ATOMIC_RELAXED);
+		int col = __atomic_load_n(&store->column[id], __ATOMIC_RELAXED);
+		if (__atomic_load_n(&store->exploded[id], __ATOMIC_RELAXED) == false && row > LAUNCH_ROW &&
+				row < r->sceneRows && col >= 0 && col < r->sceneCols)
+			r->scene[row * r->sceneCols + col] = MISSILE_GRAPHIC;
+	}
+	drawViewport(r);
+}
+
+/// Function: drawBatch
+///---------------------
+/// Applies every published event to the display and refreshes the display
+/// once if anything changed. If missile events were dropped since the last
+/// repair, the scene is repaired first. Shield moves made by a key are timed
+/// from the key being read to the refresh that shows them.
+///
+/// @param r the renderer
+
+static void drawBatch(Renderer * r){
+	Event event;
+	bool changed = false;
+	uint64_t keys[KEYS_PER_FRAME];
+	int keyCount = 0;
+	while (ringConsume(r->ring, &event) == true){
+		apply(r, &event);
+		changed = true;
+		if (event.kind == EVENT_SHIELD_MOVED && event.stamp != 0){
+			if (keyCount == KEYS_PER_FRAME) // more keys than any typist sends in a frame
+				statsRecord(HIST_KEY_TO_DRAW, statsNow() - event.stamp);
+			else
+				keys[keyCount++] = event.stamp;
+		}
+	}
+	RingStats ring;
+	ringStats(r->ring, &ring);
+	if (ring.dropped > r->repaired){ // some missile was not moved on the display
+		repair(r);
+		r->repaired = ring.dropped;
+		changed = true;
+	}
+	if (changed == true){
+		uint64_t start = statsNow();
+		displayRefresh();
+		uint64_t end = statsNow();
+		statsRecord(HIST_FRAME, end - start);
+		statsCount(STAT_FRAMES);
+		for (int i = 0; i < keyCount; i++)
+			statsRecord(HIST_KEY_TO_DRAW, end - keys[i]);
+	}
+}
+
+/// Function: render
+///------------------
+/// Main method for the render thread, draws one batch per frame
+///
+/// @param arg the Renderer declared as void* for pthread operability
+/// @return NULL
+
+static void *render(void *arg){
+	Renderer * r = arg;
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (__atomic_load_n(&r->rendering, __ATOMIC_ACQUIRE) == true){
+		drawBatch(r);
+		statsPoll(); // writes a dump if SIGUSR1 asked for one
+		Mirror * mirror = __atomic_load_n(&r->mirror, __ATOMIC_ACQUIRE);
+		if (mirror != NULL)
+			mirrorPublish(mirror); // off the game's threads, once per frame
+		next.tv_nsec += r->frameTime;
+		while (next.tv_nsec >= 1000000000){
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		pthread_mutex_lock(&r->frameLock);
+		while (__atomic_load_n(&r->rendering, __ATOMIC_ACQUIRE) == true &&
+				pthread_cond_timedwait(&r->frameCond, &r->frameLock, &next) == 0)
+			; // woken early, stopRenderer is the only signaller
+		pthread_mutex_unlock(&r->frameLock);
+	}
+	drawBatch(r); // whatever was published before stopRenderer
+	return NULL;
+}
+
+/// Function: publish
+///-------------------
+/// Publishes an event, giving up only once the render thread has stopped
+///
+/// @param r the renderer, or NULL if the game is not drawn
+/// @param event the event being published
+
+static void publish(Renderer * r, const Event * event){
+	if (r == NULL || r->ring == NULL || ringPublish(r->ring, event, &r->rendering) == false){
+		if (event->kind == EVENT_TEXT)
+			free((char *)event->text);
+	}
+}
+
+/// Function: offer
+///-----------------
+/// Publishes a missile's event without ever waiting; if the render thread
+/// is a whole ring behind, the event is dropped and counted instead
+///
+/// @param r the renderer, or NULL if the game is not drawn
+/// @param event the event being published
+
+static void offer(Renderer * r, const Event * event){
+	if (r != NULL && r->ring != NULL)
+		ringOffer(r->ring, event);
+}
+
+/// Function: createRenderer
+///--------------------------
+/// Allocates a blank scene as large as the world, shown through a viewport
+/// the size of the selected display
+///
+/// @param rows number of rows in the world
+/// @param cols number of columns in the world
+/// @return Renderer pointer to the dynamically allocated renderer, or NULL
+
+Renderer * createRenderer(int rows, int cols){
+	assert(rows > 0 && cols > 0);
+	Renderer * new = calloc(1, sizeof(struct Renderer_S));
+	if (new == NULL)
+		return NULL;
+	new->viewRows = displayRows();
+	new->viewCols = displayCols();
+	new->scene = malloc((size_t)rows * cols);
+	new->scenery = malloc((size_t)rows * cols);
+	new->overlay = calloc((size_t)new->viewRows * new->viewCols, 1);
+	if (new->scene == NULL || new->scenery == NULL || new->overlay == NULL){
+		destroyRenderer(new);
+		return NULL;
+	}
+	memset(new->scene, ' ', (size_t)rows * cols);
+	memset(new->scenery, ' ', (size_t)rows * cols);
+	new->sceneRows = rows;
+	new->sceneCols = cols;
+	new->offset = 0;
+	pthread_mutex_init(&new->frameLock, NULL);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // frame deadlines use the monotonic clock
+	pthread_cond_init(&new->frameCond, &attr);
+	pthread_condattr_destroy(&attr);
+	return new;
+}
+
+/// Function: destroyRenderer
+///---------------------------
+/// Stops the render thread if it runs and de-allocates the renderer
+///
+/// @param renderer the object to be de-allocated
+
+void destroyRenderer(Renderer * renderer){
+	assert(renderer != NULL);
+	stopRenderer(renderer);
+	if (renderer->scene != NULL && renderer->scenery != NULL && renderer->overlay != NULL){ // fully created
+		pthread_mutex_destroy(&renderer->frameLock);
+		pthread_cond_destroy(&renderer->frameCond);
+	}
+	free(renderer->scene);
+	free(renderer->scenery);
+	free(renderer->overlay);
+	free(renderer);
+}
+
+/// Function: sceneSet
+///--------------------
+/// Puts scenery into the scene before the render thread starts
+
+void sceneSet(Renderer * renderer, int row, int col, char ch){
+	if (row >= 0 && row < renderer->sceneRows && col >= 0 && col < renderer->sceneCols)
+		renderer->scene[row * renderer->sceneCols + col] = renderer->scenery[row * renderer->sceneCols + col] = ch;
+}
+
+/// Function: sceneShow
+///---------------------
+/// Scrolls the viewport to a world column and draws it, before the render
+/// thread starts
+///
+/// @param renderer the renderer
+/// @param col the world column brought into view
+
+void sceneShow(Renderer * renderer, int col){
+	renderer->offset = -renderer->viewCols; // forces follow() to recentre
+	follow(renderer, col, 1);
+	drawViewport(renderer);
+	displayRefresh();
+}
+
+/// Function: startRenderer
+///-------------------------
+/// Starts the render thread on the selected display
+///
+/// @param renderer the renderer being started
+/// @param fps the maximum number of refreshes per second
+/// @param queueSize the number of event slots between the game and the display
+/// @return true if the thread was started
+
+bool startRenderer(Renderer * renderer, int fps, size_t queueSize){
+	assert(renderer != NULL && renderer->ring == NULL && fps > 0);
+	Renderer * idle = NULL;
+	if (__atomic_compare_exchange_n(&drawing, &idle, renderer, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) == false)
+		return false; // the display is the terminal's, and another game's thread is drawing on it
+	renderer->frameTime = 1000000000L / fps;
+	renderer->ring = createRing(queueSize);
+	if (renderer->ring == NULL){
+		__atomic_store_n(&drawing, NULL, __ATOMIC_RELEASE);
+		return false;
+	}
+	__atomic_store_n(&renderer->rendering, true, __ATOMIC_RELEASE);
+	if (pthread_create(&renderer->thread, NULL, &render, renderer) != 0){
+		__atomic_store_n(&renderer->rendering, false, __ATOMIC_RELEASE);
+		destroyRing(renderer->ring);
+		renderer->ring = NULL;
+		__atomic_store_n(&drawing, NULL, __ATOMIC_RELEASE);
+		return false;
+	}
+	return true;
+}
+
+/// Function: stopRenderer
+///------------------------
+/// Draws any published events and stops the render thread without
+/// waiting out its current frame
+///
+/// @param renderer the renderer being stopped, or NULL
+
+void stopRenderer(Renderer * renderer){
+	if (renderer == NULL || renderer->ring == NULL)
+		return;
+	pthread_mutex_lock(&renderer->frameLock);
+	__atomic_store_n(&renderer->rendering, false, __ATOMIC_RELEASE);
+	pthread_cond_signal(&renderer->frameCond);
+	pthread_mutex_unlock(&renderer->frameLock);
+	pthread_join(renderer->thread, NULL);
+	ringStats(renderer->ring, &renderer->finalStats);
+	destroyRing(renderer->ring);
+	renderer->ring = NULL;
+	__atomic_store_n(&drawing, NULL, __ATOMIC_RELEASE);
+}
+
+/// Function: renderMirror
+///------------------------
+/// Has the render thread write a mirror of the game once per frame
+///
+/// @param renderer the renderer
+/// @param mirror the game's mirror, or NULL to stop writing it
+
+void renderMirror(Renderer * renderer, Mirror * mirror){
+	__atomic_store_n(&renderer->mirror, mirror, __ATOMIC_RELEASE);
+}
+
+/// Function: renderRepair
+///------------------------
+/// Gives the render thread the missiles to repair the scene from when
+/// their events are dropped
+///
+/// @param renderer the renderer
+/// @param store the game's missiles, or NULL to stop repairing
+
+void renderRepair(Renderer * renderer, MissileStore * store){
+	__atomic_store_n(&renderer->store, store, __ATOMIC_RELEASE);
+}
+
+/// Function: renderStats
+///-----------------------
+/// Reads the event ring's counters
+///
+/// @param renderer the renderer
+/// @param stats where the counters are stored
+
+void renderStats(Renderer * renderer, RingStats * stats){
+	if (renderer->ring != NULL)
+		ringStats(renderer->ring, stats);
+	else
+		*stats = renderer->finalStats;
+}
+
+/// Function: renderMissileMoved
+///------------------------------
+/// Publishes a missile falling without exploding
+
+void renderMissileMoved(Renderer * renderer, int col, int from, int row, char graphic){
+	Event event = { EVENT_MISSILE_MOVED, row, col, from, graphic, NULL, 0 };
+	offer(renderer, &event);
+}
+
+/// Function: renderMissileExploded
+///---------------------------------
+/// Publishes a missile falling and exploding
+
+void renderMissileExploded(Renderer * renderer, int col, int from, int row){
+	Event event = { EVENT_MISSILE_EXPLODED, row, col, from, '\0', NULL, 0 };
+	offer(renderer, &event);
+}
+
+/// Function: renderShieldMoved
+///-----------------------------
+/// Publishes the shield being redrawn
+
+void renderShieldMoved(Renderer * renderer, int row, int from, int col, const char * graphic, uint64_t stamp){
+	Event event = { EVENT_SHIELD_MOVED, row, col, from, '\0', graphic, stamp };
+	publish(renderer, &event);
+}
+
+/// Function: renderPrint
+///-----------------------
+/// Publishes printf-style formatted text at the given position
+
+void renderPrint(Renderer * renderer, int row, int col, const char * format, ...){
+	if (renderer == NULL)
+		return; // nobody would read it
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	Event event = { EVENT_TEXT, row, col, 0, '\0', strdup(text), 0 };
+	publish(renderer, &event);
+}
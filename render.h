@@ -0,0 +1,143 @@
+/// render.h - header file for the render thread
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the render thread. Game threads publish
+/// events into a lock-free ring; the render thread applies them to a scene
+/// as wide as the world and shows a viewport of it that follows the shield,
+/// refreshing the display at most once per frame. Every game that is drawn
+/// has a renderer of its own, though the display is the terminal's: only one
+/// renderer's thread draws on it at a time.
+
+#ifndef _RENDER_H
+#define _RENDER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ring.h"
+#include "mirror.h"
+
+/// DEFAULT_FPS is the frame rate used when none is requested
+
+#define DEFAULT_FPS 60
+
+/// DEFAULT_QUEUE is the number of event slots used when none is requested
+
+#define DEFAULT_QUEUE 4096
+
+/// Renderer is one game's scene, event ring and render thread
+
+typedef struct Renderer_S Renderer;
+
+/// createRenderer - Allocates a blank scene as large as the world.
+///
+/// @param rows number of rows in the world
+/// @param cols number of columns in the world, however wide the display is
+/// @return Renderer pointer to the renderer, or NULL if it could not be allocated
+
+Renderer * createRenderer( int rows, int cols );
+
+/// destroyRenderer - Stops the render thread if it runs and destroys all
+/// dynamically allocated storage for the renderer.
+///
+/// @param renderer the renderer to destroy
+
+void destroyRenderer( Renderer *renderer );
+
+/// sceneSet - Puts scenery into the scene before the render thread starts.
+///
+/// @param renderer the renderer
+/// @param row the row of the cell
+/// @param col the world column of the cell
+/// @param ch the cell's contents
+
+void sceneSet( Renderer *renderer, int row, int col, char ch );
+
+/// sceneShow - Brings a world column into view and draws the viewport,
+/// before the render thread starts.
+///
+/// @param renderer the renderer
+/// @param col the world column to show
+
+void sceneShow( Renderer *renderer, int col );
+
+/// startRenderer - Starts the render thread on the selected display.
+///
+/// @param renderer the renderer to start
+/// @param fps the maximum number of refreshes per second
+/// @param queueSize the number of event slots between the game and the display
+/// @return true if the thread was started, false also while another
+///         renderer's thread is drawing on the display
+
+bool startRenderer( Renderer *renderer, int fps, size_t queueSize );
+
+/// stopRenderer - Draws any published events and stops the render thread.
+///
+/// @param renderer the renderer to stop, or NULL
+
+void stopRenderer( Renderer *renderer );
+
+/// renderMirror - Has the render thread write a mirror once per frame.
+///
+/// @param renderer the renderer
+/// @param mirror the game's mirror, or NULL to stop writing it
+
+void renderMirror( Renderer *renderer, Mirror *mirror );
+
+/// renderRepair - Gives the render thread the game's missiles. Whenever
+/// missile events have been dropped, the scene is rebuilt from them, the
+/// collision grid and the shield before the next frame is drawn, the last
+/// one included.
+///
+/// @param renderer the renderer
+/// @param store the game's missiles, or NULL to stop repairing
+
+void renderRepair( Renderer *renderer, MissileStore *store );
+
+/// renderStats - Reads the event ring's counters, also after stopRenderer.
+///
+/// @param renderer the renderer
+/// @param stats where the counters are stored
+
+void renderStats( Renderer *renderer, RingStats *stats );
+
+/// renderMissileMoved - Publishes a missile falling without exploding. It
+/// never waits: if the render thread is a whole ring behind, the event is
+/// dropped and counted in the ring's stats.
+///
+/// @param renderer the game's renderer, or NULL if it is not drawn
+/// @param col the missile's column
+/// @param from the row it was drawn on
+/// @param row the row it is drawn on now
+/// @param graphic the missile's graphic
+
+void renderMissileMoved( Renderer *renderer, int col, int from, int row, char graphic );
+
+/// renderMissileExploded - Publishes a missile falling and exploding, or
+/// drops it like renderMissileMoved.
+///
+/// @param renderer the game's renderer, or NULL if it is not drawn
+/// @param col the missile's column
+/// @param from the row it was drawn on
+/// @param row the row it exploded on
+
+void renderMissileExploded( Renderer *renderer, int col, int from, int row );
+
+/// renderShieldMoved - Publishes the shield being redrawn, waiting for room
+/// in the ring; the caller must not hold a stripe lock.
+///
+/// @param renderer the game's renderer, or NULL if it is not drawn
+/// @param row the shield's row
+/// @param from the column it was drawn at
+/// @param col the column it is drawn at now
+/// @param graphic the shield's graphic, which must outlive the game
+/// @param stamp when the key that moved the shield was read, 0 if none
+
+void renderShieldMoved( Renderer *renderer, int row, int from, int col, const char *graphic, uint64_t stamp );
+
+/// renderPrint - Publishes printf-style formatted text at the given position.
+/// Nothing is published when renderer is NULL.
+
+void renderPrint( Renderer *renderer, int row, int col, const char *format, ... );
+
+#endif
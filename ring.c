@@ -0,0 +1,194 @@
+/// Program: ring.c
+///-----------------
+/// Bounded multi-producer, single-consumer ring buffer of game events.
+/// Every slot carries a sequence number that tells producers and the
+/// consumer whose turn it is, so neither side takes a lock.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "ring.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+
+#define CACHE_LINE 64
+
+/// Slot_S structure is one position in the ring
+
+typedef struct Slot_S {
+
+	size_t sequence; ///< equals the position when free, position + 1 when full
+
+	Event event; ///< the stored event
+
+} Slot;
+
+struct EventRing_S {
+
+	size_t mask; ///< capacity - 1, capacity being a power of two
+
+	Slot *slots; ///< the ring itself
+
+	char pad0[CACHE_LINE];
+
+	size_t tail; ///< next position producers claim, also the publish count
+
+	char pad1[CACHE_LINE];
+
+	size_t head; ///< next position the consumer reads, also the consume count
+
+	char pad2[CACHE_LINE];
+
+	size_t highWater; ///< deepest the ring has been
+
+	size_t stalls; ///< publish attempts that found the ring full
+
+	size_t dropped; ///< events abandoned with no consumer running
+};
+
+/// Function: createRing
+///----------------------
+/// Creates a new, empty ring
+///
+/// @param capacity requested number of slots, rounded up to a power of two
+/// @return EventRing pointer to the dynamically allocated ring object
+
+EventRing * createRing(size_t capacity){
+	size_t size = 2;
+	while (size < capacity)
+		size *= 2;
+	EventRing * new = calloc(1, sizeof(struct EventRing_S));
+	if (new == NULL)
+		return NULL;
+	new->slots = malloc(size * sizeof(Slot));
+	if (new->slots == NULL){
+		free(new);
+		return NULL;
+	}
+	for (size_t i = 0; i < size; i++)
+		new->slots[i].sequence = i;
+	new->mask = size - 1;
+	return new;
+}
+
+/// Function: destroyRing
+///-----------------------
+/// De-allocates all dynamic memory for a ring
+///
+/// @param ring pointer to the ring being freed
+
+void destroyRing(EventRing * ring){
+	assert(ring != NULL);
+	free(ring->slots);
+	free(ring);
+}
+
+/// Function: ringTryPublish
+///--------------------------
+/// Claims the next free slot with a compare-and-swap on the tail, fills it,
+/// then hands it to the consumer by advancing the slot's sequence
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @return false if the ring was full
+
+bool ringTryPublish(EventRing * ring, const Event * event){
+	size_t position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	Slot * slot;
+	for (;;){
+		slot = &ring->slots[position & ring->mask];
+		size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		long difference = (long)(sequence - position);
+		if (difference == 0){ // the slot is free for this position
+			if (__atomic_compare_exchange_n(&ring->tail, &position, position + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (difference < 0){ // the consumer hasn't freed it yet
+			__atomic_fetch_add(&ring->stalls, 1, __ATOMIC_RELAXED);
+			return false;
+		} else // another producer claimed it first
+			position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	}
+	slot->event = *event;
+	__atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+
+	size_t depth = position + 1 - __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	size_t high = __atomic_load_n(&ring->highWater, __ATOMIC_RELAXED);
+	while (depth > high && !__atomic_compare_exchange_n(&ring->highWater, &high, depth,
+			true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return true;
+}
+
+/// Function: ringOffer
+///---------------------
+/// Publishes an event if there is room, and otherwise drops it
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @return false if the event was dropped
+
+bool ringOffer(EventRing * ring, const Event * event){
+	if (ringTryPublish(ring, event) == true)
+		return true;
+	__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+	return false;
+}
+
+/// Function: ringPublish
+///-----------------------
+/// Publishes an event, yielding the processor while the ring is full
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @param consuming whether a consumer is still draining the ring
+/// @return false if the event was dropped
+
+bool ringPublish(EventRing * ring, const Event * event, const bool * consuming){
+	while (ringTryPublish(ring, event) == false){
+		if (__atomic_load_n(consuming, __ATOMIC_ACQUIRE) == false){ // nobody will ever make room
+			__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+			return false;
+		}
+		sched_yield();
+	}
+	return true;
+}
+
+/// Function: ringConsume
+///-----------------------
+/// Takes the oldest event out of the ring and frees its slot for the
+/// producers one lap later
+///
+/// @param ring the ring consumed from
+/// @param event where the event is stored
+/// @return false if the ring was empty
+
+bool ringConsume(EventRing * ring, Event * event){
+	size_t position = ring->head;
+	Slot * slot = &ring->slots[position & ring->mask];
+	if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != position + 1)
+		return false; // empty, or the producer is still filling it
+	*event = slot->event;
+	__atomic_store_n(&slot->sequence, position + ring->mask + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->head, position + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+/// Function: ringStats
+///---------------------
+/// Reads the ring's counters
+///
+/// @param ring the ring being measured
+/// @param stats where the counters are stored
+
+void ringStats(EventRing * ring, RingStats * stats){
+	stats->capacity = ring->mask + 1;
+	stats->published = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	stats->consumed = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	stats->depth = stats->published - stats->consumed;
+	stats->highWater = __atomic_load_n(&ring->highWater, __ATOMIC_RELAXED);
+	stats->stalls = __atomic_load_n(&ring->stalls, __ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,131 @@
+/// ring.h - header file for the game event ring
+///
+/// @author Brennan Reed
+///
+/// This is the interface for a bounded, lock-free ring buffer of game
+/// events. Any number of game threads publish into it and a single
+/// consumer, the render thread, takes events out in order.
+
+#ifndef _RING_H
+#define _RING_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// EventKind enumerates the events the game publishes
+
+typedef enum EventKind_E {
+
+    EVENT_MISSILE_MOVED,    ///< a missile fell from one row to another
+
+    EVENT_MISSILE_EXPLODED, ///< a missile fell and exploded
+
+    EVENT_SHIELD_MOVED,     ///< the shield moved along its row
+
+    EVENT_TEXT              ///< a message was printed
+
+} EventKind;
+
+/// Event_S structure is one published event
+
+typedef struct Event_S {
+
+    EventKind kind; ///< what happened
+
+    int row; ///< row the missile or shield ended on, or the text row
+
+    int col; ///< column of the missile, the shield or the text
+
+    int from; ///< row the missile fell from, or column the shield left
+
+    char ch; ///< the missile graphic
+
+    const char *text; ///< the shield graphic, or the message owned by the event
+
+    uint64_t stamp; ///< when the key that moved the shield was read, 0 if none
+
+} Event;
+
+/// RingStats_S structure holds the ring's counters
+
+typedef struct RingStats_S {
+
+    size_t capacity;  ///< number of slots in the ring
+
+    size_t depth;     ///< events waiting to be consumed
+
+    size_t highWater; ///< the deepest the ring has been
+
+    size_t published; ///< events successfully published
+
+    size_t consumed;  ///< events taken out by the consumer
+
+    size_t stalls;    ///< publish attempts that found the ring full
+
+    size_t dropped;   ///< events abandoned, offered to a full ring or left with nobody consuming
+
+} RingStats;
+
+/// EventRing_S structure is private to ring.c
+
+typedef struct EventRing_S EventRing;
+
+/// createRing - Create a new, empty ring.
+///
+/// @param capacity requested number of slots, rounded up to a power of two
+/// @return EventRing pointer to a dynamically allocated EventRing object
+
+EventRing * createRing( size_t capacity );
+
+/// destroyRing - Destroy all dynamically allocated storage for a ring.
+///
+/// @param ring the object to be de-allocated
+
+void destroyRing( EventRing *ring );
+
+/// ringTryPublish - Publishes an event if there is room, without waiting.
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @return false if the ring was full
+
+bool ringTryPublish( EventRing *ring, const Event *event );
+
+/// ringOffer - Publishes an event if there is room, and otherwise drops it
+/// and counts the drop; never waits, so it is safe on the game's hot path.
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @return false if the event was dropped
+
+bool ringOffer( EventRing *ring, const Event *event );
+
+/// ringPublish - Publishes an event, yielding while the ring is full. The
+/// caller must not hold any lock a game thread may wait for.
+///
+/// @param ring the ring published to
+/// @param event the event being published
+/// @param consuming whether a consumer is still draining the ring, read
+///        atomically; once it is not, a full ring drops the event instead
+///        of waiting
+/// @return false if the event was dropped
+
+bool ringPublish( EventRing *ring, const Event *event, const bool *consuming );
+
+/// ringConsume - Takes the oldest event out of the ring.
+///
+/// @param ring the ring consumed from
+/// @param event where the event is stored
+/// @return false if the ring was empty
+/// @pre only one thread consumes from a ring.
+
+bool ringConsume( EventRing *ring, Event *event );
+
+/// ringStats - Reads the ring's counters.
+///
+/// @param ring the ring being measured
+/// @param stats where the counters are stored
+
+void ringStats( EventRing *ring, RingStats *stats );
+
+#endif
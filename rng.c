@@ -0,0 +1,87 @@
+/// Program: rng.c
+///----------------
+/// xoshiro256** random number generator with splitmix64 seeding
+///
+/// @author Brennan Reed
+
+#include "rng.h"
+#include <stddef.h>
+#include <assert.h>
+
+/// Function: splitmix
+///--------------------
+/// Advances a splitmix64 state, used to spread a seed over xoshiro's state
+///
+/// @param state the splitmix64 state
+/// @return the next splitmix64 output
+
+static uint64_t splitmix(uint64_t * state){
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/// Function: rotl
+///----------------
+/// Rotates a 64-bit word left
+
+static uint64_t rotl(uint64_t x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+/// Function: rngSeed
+///-------------------
+/// Derives an independent stream from a seed and a stream number
+///
+/// @param rng the stream being seeded
+/// @param seed the game seed
+/// @param stream which stream of the seed
+
+void rngSeed(Rng * rng, uint64_t seed, uint64_t stream){
+	assert(rng != NULL);
+	uint64_t state = seed;
+	state = splitmix(&state) ^ (stream * 0xd1b54a32d192ed03ULL); // mixes in the stream number
+	for (int i = 0; i < 4; i++)
+		rng->s[i] = splitmix(&state); // splitmix64 never yields an all-zero state
+}
+
+/// Function: rngNext
+///-------------------
+/// Draws the next 64 random bits
+///
+/// @param rng the stream drawn from
+/// @return the random bits
+
+uint64_t rngNext(Rng * rng){
+	uint64_t * s = rng->s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+/// Function: rngBelow
+///--------------------
+/// Draws a uniformly distributed number below a bound using Lemire's
+/// multiply-and-shift, rejecting the few values that would bias it
+///
+/// @param rng the stream drawn from
+/// @param bound the exclusive upper bound
+/// @return a number in [0, bound)
+
+uint32_t rngBelow(Rng * rng, uint32_t bound){
+	assert(bound > 0);
+	uint64_t product = (rngNext(rng) >> 32) * bound;
+	if ((uint32_t)product < bound){
+		uint32_t threshold = -bound % bound;
+		while ((uint32_t)product < threshold)
+			product = (rngNext(rng) >> 32) * bound;
+	}
+	return product >> 32;
+}
@@ -0,0 +1,44 @@
+/// rng.h - header file for the game's random number generator
+///
+/// @author Brennan Reed
+///
+/// This is the interface for xoshiro256**, a small, fast generator. Every
+/// missile owns its own stream derived from the game seed, so a seed
+/// replays the same columns and fall timings however threads are scheduled.
+
+#ifndef _RNG_H
+#define _RNG_H
+#include <stdint.h>
+
+/// Rng_S structure is the 256-bit state of one stream.
+
+typedef struct Rng_S {
+
+    uint64_t s[4]; ///< generator state, never all zero
+
+} Rng;
+
+/// rngSeed - Derives an independent stream from a seed and a stream number.
+///
+/// @param rng the stream being seeded
+/// @param seed the game seed
+/// @param stream which stream of the seed, e.g. a missile's index
+
+void rngSeed( Rng *rng, uint64_t seed, uint64_t stream );
+
+/// rngNext - Draws the next 64 random bits.
+///
+/// @param rng the stream drawn from
+/// @return the random bits
+
+uint64_t rngNext( Rng *rng );
+
+/// rngBelow - Draws a uniformly distributed number below a bound.
+///
+/// @param rng the stream drawn from
+/// @param bound the exclusive upper bound, greater than 0
+/// @return a number in [0, bound)
+
+uint32_t rngBelow( Rng *rng, uint32_t bound );
+
+#endif
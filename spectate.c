@@ -0,0 +1,160 @@
+/// Program: spectate.c
+///---------------------
+/// Watches a game started with --mirror from another process. It attaches
+/// to the game's shared-memory segment, copies a snapshot out at a fixed
+/// interval, and reports once a second what the game is doing and how old
+/// the snapshots it reads are. Every snapshot's checksum is checked, so a
+/// torn copy would be caught.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "mirror.h"
+#include "stats.h"
+
+#define DEFAULT_INTERVAL	1000
+#define DEFAULT_WAIT	10
+#define STALE_BUCKET_NS	10000
+#define STALE_BUCKETS	10000
+#define SILENCE_NS	2000000000
+
+static size_t staleness[STALE_BUCKETS]; // reads by age, 10 microseconds a bucket, the last holds older ones
+
+/// Function: percentile
+///----------------------
+/// Finds the bucket holding a percentile of the reads' staleness
+///
+/// @param reads the number of reads counted
+/// @param percent the percentile, from 0 to 100
+/// @return the bucket's upper bound in microseconds
+
+static double percentile(size_t reads, double percent){
+	size_t rank = (size_t)(reads * percent / 100), seen = 0;
+	for (int bucket = 0; bucket < STALE_BUCKETS; bucket++){
+		seen += staleness[bucket];
+		if (seen > rank)
+			return (bucket + 1) * STALE_BUCKET_NS / 1000.0;
+	}
+	return STALE_BUCKETS * STALE_BUCKET_NS / 1000.0;
+}
+
+/// Function: main
+///----------------
+/// Attaches to a mirrored game and reports on it until the game ends
+///
+/// @param argc number of commandline arguments
+/// @param argv array of commandline argument strings
+/// @return 0 if every snapshot read was consistent, else EXIT_FAILURE
+
+int main(int argc, char* argv[]){
+	char * usage = "usage: ./spectate [-i interval-us] [-w wait-seconds] [-n seconds] name\n";
+	long interval = DEFAULT_INTERVAL; // microseconds between reads
+	int wait = DEFAULT_WAIT; // seconds to wait for the game to start mirroring
+	int limit = 0; // seconds to watch for, 0 until the game ends
+	int opt;
+	while ((opt = getopt(argc, argv, "i:w:n:")) != -1){
+		switch (opt){
+			case 'i':
+				interval = atol(optarg);
+				break;
+			case 'w':
+				wait = atoi(optarg);
+				break;
+			case 'n':
+				limit = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "%s", usage);
+				return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 1 || interval < 0 || wait < 0 || limit < 0){
+		fprintf(stderr, "%s", usage);
+		return EXIT_FAILURE;
+	}
+	MirrorView view;
+	bool attached = mirrorAttach(argv[optind], &view);
+	for (int tries = 0; attached == false && tries < wait * 10; tries++){
+		usleep(100000); // the game may not have opened its mirror yet
+		attached = mirrorAttach(argv[optind], &view);
+	}
+	if (attached == false){
+		fprintf(stderr, "Error: no game is mirrored as %s.\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	const MirrorHeader * header = view.header;
+	printf("attached: %d x %d world, %" PRIu64 " city columns, %" PRIu64 " missile slots\n",
+			header->rows, header->columns, header->cityColumns, header->capacity);
+	MirrorMissile * missiles = malloc((header->capacity + 1) * sizeof(MirrorMissile));
+	if (missiles == NULL){
+		mirrorDetach(&view);
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+		return EXIT_FAILURE;
+	}
+	MirrorState state;
+	size_t reads = 0, retries = 0, torn = 0, frames = 0;
+	uint64_t firstFrame = 0, lastFrame = 0, costNs = 0, maxStaleNs = 0;
+	uint64_t start = statsNow(), report = start + 1000000000, heard = start;
+	size_t windowReads = 0;
+	uint64_t windowStaleNs = 0, windowMaxNs = 0;
+	for (;;){
+		uint64_t before = statsNow();
+		retries += mirrorRead(&view, &state, missiles);
+		uint64_t now = statsNow();
+		costNs += now - before;
+		reads++;
+		if (mirrorChecksum(missiles, state.launched) != state.checksum)
+			torn++;
+		uint64_t stale = now > state.published ? now - state.published : 0;
+		staleness[stale / STALE_BUCKET_NS < STALE_BUCKETS ? stale / STALE_BUCKET_NS : STALE_BUCKETS - 1]++;
+		if (stale > maxStaleNs)
+			maxStaleNs = stale;
+		windowReads++;
+		windowStaleNs += stale;
+		if (stale > windowMaxNs)
+			windowMaxNs = stale;
+		if (state.frame != lastFrame){
+			if (frames == 0)
+				firstFrame = state.frame;
+			frames++;
+			lastFrame = state.frame;
+			heard = now;
+		}
+		bool done = state.ended != 0 || (limit > 0 && now - start >= (uint64_t)limit * 1000000000);
+		if (now >= report || done){
+			size_t live = 0, exploded = 0;
+			for (uint64_t i = 0; i < state.launched; i++){
+				if (missiles[i].exploded != 0)
+					exploded++;
+				else
+					live++;
+			}
+			printf("frame %" PRIu64 "  game %.1fs  live %zu  exploded %zu  blocked %" PRIu64 "  shield %d  staleness mean %.2fms max %.2fms\n",
+					state.frame, state.gameTime / 1e6, live, exploded, state.hits[HIT_SHIELD], state.shieldColumn,
+					windowStaleNs / 1e6 / windowReads, windowMaxNs / 1e6);
+			fflush(stdout);
+			report += 1000000000;
+			windowReads = 0;
+			windowStaleNs = windowMaxNs = 0;
+		}
+		if (done)
+			break;
+		if (now - heard > SILENCE_NS){
+			printf("%s", "the game stopped publishing\n");
+			break;
+		}
+		usleep(interval);
+	}
+	printf("spectate: %zu reads, %zu of %" PRIu64 " frames seen, %zu retries, %zu torn, "
+			"read %.1fus mean, staleness p50 %.2fms p99 %.2fms max %.2fms\n",
+			reads, frames, lastFrame - firstFrame + 1, retries, torn, costNs / 1e3 / reads,
+			percentile(reads, 50) / 1000, percentile(reads, 99) / 1000, maxStaleNs / 1e6);
+	free(missiles);
+	mirrorDetach(&view);
+	return torn == 0 ? 0 : EXIT_FAILURE;
+}
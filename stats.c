@@ -0,0 +1,234 @@
+/// Program: stats.c
+///------------------
+/// Counters and log2 latency histograms for the game's hot paths. Every
+/// thread gets its own block the first time it records something; only
+/// that thread writes to it, with relaxed atomics, and blocks are pushed
+/// onto a lock-free list so readers can add them up at any time.
+///
+/// @author Brennan Reed
+
+#define _DEFAULT_SOURCE
+#include "stats.h"
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <inttypes.h>
+
+/// StatsBlock_S structure is one thread's counters and histograms
+
+typedef struct StatsBlock_S {
+
+	uint64_t counters[STAT_COUNTERS]; ///< written only by the owning thread
+
+	uint64_t histograms[STAT_HISTOGRAMS][STAT_BUCKETS]; ///< written only by the owning thread
+
+	struct StatsBlock_S *next; ///< the block registered before this one
+
+} StatsBlock;
+
+static StatsBlock * blocks; // every registered block, newest first
+static StatsBlock overflow; // shared by threads whose block could not be allocated
+static __thread StatsBlock * mine; // the calling thread's block
+static const char * dumpPath; // where SIGUSR1 dumps go
+static volatile sig_atomic_t dumpRequested;
+
+static const char * counterNames[STAT_COUNTERS] = { "advances", "explosions",
+		"shield moves", "lock yields", "frames", "bytes written" };
+static const char * histogramNames[STAT_HISTOGRAMS] = { "lock wait", "lock hold", "frame",
+		"key to draw", "frame output" };
+static const char * histogramUnits[STAT_HISTOGRAMS] = { "ns", "ns", "ns", "ns", "bytes" };
+
+/// Function: block
+///-----------------
+/// Finds the calling thread's block, registering a new one the first time
+///
+/// @return the block the calling thread records into
+
+static StatsBlock * block(void){
+	if (mine != NULL)
+		return mine;
+	StatsBlock * new = calloc(1, sizeof(StatsBlock));
+	if (new == NULL)
+		return mine = &overflow; // counts may be lost to races, but nothing crashes
+	new->next = __atomic_load_n(&blocks, __ATOMIC_RELAXED);
+	while (__atomic_compare_exchange_n(&blocks, &new->next, new, true,
+			__ATOMIC_RELEASE, __ATOMIC_RELAXED) == false)
+		;
+	return mine = new;
+}
+
+/// Function: bump
+///----------------
+/// Adds to a slot only the calling thread writes, so no read-modify-write
+/// instruction is needed
+///
+/// @param slot the slot being incremented
+/// @param amount what is added
+
+static void bump(uint64_t * slot, uint64_t amount){
+	__atomic_store_n(slot, __atomic_load_n(slot, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+/// Function: statsNow
+///--------------------
+/// Reads the monotonic clock
+///
+/// @return the current monotonic time in nanoseconds
+
+uint64_t statsNow(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// Function: statsCount
+///----------------------
+/// Counts one event for the calling thread
+
+void statsCount(StatCounter counter){
+	bump(&block()->counters[counter], 1);
+}
+
+/// Function: statsAdd
+///--------------------
+/// Counts several events at once for the calling thread
+
+void statsAdd(StatCounter counter, uint64_t amount){
+	bump(&block()->counters[counter], amount);
+}
+
+/// Function: statsRecord
+///-----------------------
+/// Records one duration in the calling thread's histogram
+
+void statsRecord(StatHistogram histogram, uint64_t ns){
+	int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+	if (bucket >= STAT_BUCKETS)
+		bucket = STAT_BUCKETS - 1;
+	bump(&block()->histograms[histogram][bucket], 1);
+}
+
+/// Function: addBlock
+///--------------------
+/// Adds one block's counters and histograms to a snapshot
+///
+/// @param snapshot the totals being accumulated
+/// @param b the block being added
+
+static void addBlock(StatsSnapshot * snapshot, StatsBlock * b){
+	for (int c = 0; c < STAT_COUNTERS; c++)
+		snapshot->counters[c] += __atomic_load_n(&b->counters[c], __ATOMIC_RELAXED);
+	for (int h = 0; h < STAT_HISTOGRAMS; h++){
+		for (int i = 0; i < STAT_BUCKETS; i++)
+			snapshot->histograms[h][i] += __atomic_load_n(&b->histograms[h][i], __ATOMIC_RELAXED);
+	}
+}
+
+/// Function: statsSnapshot
+///-------------------------
+/// Adds up every thread's counters and histograms
+
+void statsSnapshot(StatsSnapshot * snapshot){
+	memset(snapshot, 0, sizeof(StatsSnapshot));
+	for (StatsBlock * b = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE); b != NULL; b = b->next){
+		addBlock(snapshot, b);
+		snapshot->threads++;
+	}
+	addBlock(snapshot, &overflow);
+}
+
+/// Function: statsPercentile
+///---------------------------
+/// Finds the bucket holding a percentile of a histogram
+
+uint64_t statsPercentile(const StatsSnapshot * snapshot, StatHistogram histogram, double percent){
+	const uint64_t * buckets = snapshot->histograms[histogram];
+	uint64_t total = 0;
+	for (int i = 0; i < STAT_BUCKETS; i++)
+		total += buckets[i];
+	if (total == 0)
+		return 0;
+	uint64_t rank = (uint64_t)(total * percent / 100.0);
+	if (rank >= total)
+		rank = total - 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < STAT_BUCKETS; i++){
+		seen += buckets[i];
+		if (seen > rank)
+			return (uint64_t)1 << i;
+	}
+	return (uint64_t)1 << (STAT_BUCKETS - 1);
+}
+
+/// Function: statsWrite
+///----------------------
+/// Writes a summary of the totals so far
+///
+/// @param fp the stream written to
+/// @param buckets true to also list every non-empty histogram bucket
+
+void statsWrite(FILE * fp, bool buckets){
+	StatsSnapshot snapshot;
+	statsSnapshot(&snapshot);
+	fprintf(fp, "stats:");
+	for (int c = 0; c < STAT_COUNTERS; c++)
+		fprintf(fp, "%s %" PRIu64 " %s", c == 0 ? "" : ",", snapshot.counters[c], counterNames[c]);
+	fprintf(fp, " from %zu threads\n", snapshot.threads);
+	for (int h = 0; h < STAT_HISTOGRAMS; h++){
+		if (statsPercentile(&snapshot, h, 100) == 0){
+			fprintf(fp, "%s %s: none recorded\n", histogramNames[h], histogramUnits[h]);
+			continue;
+		}
+		fprintf(fp, "%s %s: p50 < %" PRIu64 ", p99 < %" PRIu64 ", max < %" PRIu64 "\n", histogramNames[h], histogramUnits[h],
+				statsPercentile(&snapshot, h, 50), statsPercentile(&snapshot, h, 99),
+				statsPercentile(&snapshot, h, 100));
+		for (int i = 0; buckets == true && i < STAT_BUCKETS; i++){
+			if (snapshot.histograms[h][i] > 0)
+				fprintf(fp, "  < %" PRIu64 ": %" PRIu64 "\n", (uint64_t)1 << i, snapshot.histograms[h][i]);
+		}
+	}
+}
+
+/// Function: requestDump
+///-----------------------
+/// SIGUSR1 handler; only raises a flag, the render thread does the writing
+///
+/// @param signal unused
+
+static void requestDump(int signal){
+	(void)signal;
+	dumpRequested = 1;
+}
+
+/// Function: statsWatch
+///----------------------
+/// Dumps the totals to a file whenever SIGUSR1 arrives
+///
+/// @param path the file that each dump replaces
+/// @return true if the signal handler was installed
+
+bool statsWatch(const char * path){
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &requestDump;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	dumpPath = path;
+	return sigaction(SIGUSR1, &action, NULL) == 0;
+}
+
+/// Function: statsPoll
+///---------------------
+/// Writes the dump if SIGUSR1 arrived since the last poll
+
+void statsPoll(void){
+	if (dumpRequested == 0 || dumpPath == NULL)
+		return;
+	dumpRequested = 0;
+	FILE * fp = fopen(dumpPath, "w");
+	if (fp == NULL)
+		return;
+	statsWrite(fp, true);
+	fclose(fp);
+}
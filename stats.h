@@ -0,0 +1,131 @@
+/// stats.h - header file for the game's instrumentation
+///
+/// @author Brennan Reed
+///
+/// This is the interface for counters and latency histograms kept on the
+/// game's hot paths. Each thread updates a block of its own, so recording
+/// takes no lock; readers add every block up when they need a total.
+
+#ifndef _STATS_H
+#define _STATS_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// StatCounter_E enumeration names the events that are counted
+
+typedef enum StatCounter_E {
+
+    STAT_ADVANCES, ///< missile rows fallen
+
+    STAT_EXPLOSIONS, ///< missiles exploded
+
+    STAT_SHIELD_MOVES, ///< shield moves
+
+    STAT_LOCK_YIELDS, ///< missiles that stood aside for a waiting shield
+
+    STAT_FRAMES, ///< display refreshes
+
+    STAT_OUTPUT_BYTES, ///< bytes the ANSI backend wrote to the terminal
+
+    STAT_COUNTERS ///< number of counters
+
+} StatCounter;
+
+/// StatHistogram_E enumeration names the durations that are recorded
+
+typedef enum StatHistogram_E {
+
+    HIST_LOCK_WAIT, ///< nanoseconds spent acquiring the game lock
+
+    HIST_LOCK_HOLD, ///< nanoseconds the game lock was held
+
+    HIST_FRAME, ///< nanoseconds taken by a display refresh
+
+    HIST_KEY_TO_DRAW, ///< nanoseconds from reading a key to showing the shield's move
+
+    HIST_FRAME_BYTES, ///< bytes the ANSI backend wrote for one frame
+
+    STAT_HISTOGRAMS ///< number of histograms
+
+} StatHistogram;
+
+/// STAT_BUCKETS is the number of power-of-two buckets in a histogram;
+/// bucket b counts durations below 2^b nanoseconds and at least half that
+
+#define STAT_BUCKETS 40
+
+/// StatsSnapshot_S structure is the sum of every thread's block.
+
+typedef struct StatsSnapshot_S {
+
+    uint64_t counters[STAT_COUNTERS]; ///< each counter's total
+
+    uint64_t histograms[STAT_HISTOGRAMS][STAT_BUCKETS]; ///< each histogram's buckets
+
+    size_t threads; ///< number of threads that recorded anything
+
+} StatsSnapshot;
+
+/// statsNow - Reads the monotonic clock.
+///
+/// @return the current monotonic time in nanoseconds
+
+uint64_t statsNow( void );
+
+/// statsCount - Counts one event for the calling thread.
+///
+/// @param counter the event that happened
+
+void statsCount( StatCounter counter );
+
+/// statsAdd - Counts several events at once for the calling thread.
+///
+/// @param counter the event that happened
+/// @param amount how many times it happened
+
+void statsAdd( StatCounter counter, uint64_t amount );
+
+/// statsRecord - Records one duration, or one size, for the calling thread.
+///
+/// @param histogram the histogram the value belongs in
+/// @param ns the duration in nanoseconds, or the size in bytes
+
+void statsRecord( StatHistogram histogram, uint64_t ns );
+
+/// statsSnapshot - Adds up every thread's counters and histograms.
+///
+/// @param snapshot where the totals are stored
+
+void statsSnapshot( StatsSnapshot *snapshot );
+
+/// statsPercentile - Finds the bucket holding a percentile of a histogram.
+///
+/// @param snapshot the totals being read
+/// @param histogram the histogram being read
+/// @param percent the percentile, from 0 to 100
+/// @return the bucket's upper bound in nanoseconds, or 0 if it is empty
+
+uint64_t statsPercentile( const StatsSnapshot *snapshot, StatHistogram histogram, double percent );
+
+/// statsWrite - Writes a summary of the totals so far.
+///
+/// @param fp the stream written to
+/// @param buckets true to also list every non-empty histogram bucket
+
+void statsWrite( FILE *fp, bool buckets );
+
+/// statsWatch - Dumps the totals to a file whenever SIGUSR1 arrives.
+///
+/// @param path the file that each dump replaces
+/// @return true if the signal handler was installed
+
+bool statsWatch( const char *path );
+
+/// statsPoll - Writes the dump if SIGUSR1 arrived since the last poll.
+/// Called regularly by the render thread, never from the signal handler.
+
+void statsPoll( void );
+
+#endif
@@ -6,93 +6,237 @@
 
 #define _DEFAULT_SOURCE
 #define MAX_SPEED_DELAY 500000
+#define STRIPE_WIDTH 16
 #include "threads.h"
+#include "batch.h"
+#include "clock.h"
+#include "display.h"
+#include "render.h"
+#include "occupancy.h"
+#include "plock.h"
+#include "record.h"
+#include "stats.h"
+#include "wheel.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
 #include <assert.h>
-#include <curses.h>
 #include <pthread.h>
 #include <unistd.h>
 
-/// global variables that are set by the init_missiles function
-int ground; // the ground height
-int height; // the shield height
-int columns; // the maximum number of columns
-bool shieldLock; // whether the shield is trying to acquire the mutex lock
-bool quit; // flag for defender game loop
-bool game; // whether the attack is occurring
-bool endless; // whether the attacker has unlimited missiles
-char * defenseForce; // the name of the defender
+/// Function: columnStripe
+///------------------------
+/// Finds the stripe a column belongs to
+///
+/// @param game the game the column is in
+/// @param column a column of the world
+/// @return the stripe's index
+
+int columnStripe(const Game * game, int column){
+	int stripe = column / STRIPE_WIDTH;
+	if (stripe < 0)
+		return 0;
+	return stripe < game->stripeCount ? stripe : game->stripeCount - 1;
+}
 
-pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/// Function: lockColumns
+///-----------------------
+/// Acquires every stripe a span of columns touches, lowest first, so two
+/// spans can never deadlock
+///
+/// @param game the game whose stripes are locked
+/// @param first the span's left-most column
+/// @param last the span's right-most column
+/// @param priority true to go ahead of every missile
+
+static void lockColumns(Game * game, int first, int last, bool priority){
+	for (int stripe = columnStripe(game, first); stripe <= columnStripe(game, last); stripe++)
+		plockAcquire(&game->stripes[stripe], priority);
+}
+
+/// Function: unlockColumns
+///-------------------------
+/// Releases the stripes lockColumns acquired
+///
+/// @param game the game whose stripes are released
+/// @param first the span's left-most column
+/// @param last the span's right-most column
+
+static void unlockColumns(Game * game, int first, int last){
+	for (int stripe = columnStripe(game, last); stripe >= columnStripe(game, first); stripe--)
+		plockRelease(&game->stripes[stripe]);
+}
 
 /// Function: initThreads
 ///------------------------
 /// does setup work for the missile before the start of the game
 ///
+/// @param game the game being set up
 /// @param groundHeight the height of the ground / highest possible missile row
 /// @param buildingHeight the height of the defense shield
 /// @param maxColumn the maximum column value displayed in the curses window
 /// @param defense the name of the defender
 /// @param endlessAttack whether the attacker has an infinite number of missiles
+/// @param occupancy the collision grid holding the city
+/// @return true if the stripe locks and the clock could be allocated
+
+bool initThreads(Game * game, int groundHeight, int buildingHeight, int maxColumn, char * defense, bool endlessAttack, Occupancy * occupancy){
+	assert(game != NULL);
+	game->stripeCount = (maxColumn + STRIPE_WIDTH) / STRIPE_WIDTH + 1; // room for the shield past the last column
+	game->stripes = malloc(game->stripeCount * sizeof(PriorityLock));
+	if (game->stripes == NULL){
+		game->stripeCount = 0;
+		game->clock = NULL;
+		return false;
+	}
+	for (int i = 0; i < game->stripeCount; i++)
+		plockInit(&game->stripes[i]);
+	game->ground = groundHeight;
+	game->height = groundHeight - buildingHeight - 2;
+	game->columns = maxColumn;
+	__atomic_store_n(&game->attacking, true, __ATOMIC_RELEASE);
+	game->endless = endlessAttack;
+	__atomic_store_n(&game->quit, false, __ATOMIC_RELEASE);
+	game->defenseForce = defense;
+	game->grid = occupancy;
+	game->autopilot = NULL;
+	game->renderer = NULL;
+	game->record = NULL;
+	game->clock = createClock();
+	if (game->clock == NULL){
+		releaseThreads(game);
+		return false;
+	}
+	for (int i = 0; i < HIT_KINDS; i++)
+		game->hits[i] = 0;
+	return true;
+}
 
-void initThreads(int groundHeight, int buildingHeight, int maxColumn, char * defense, bool endlessAttack){
-	ground = groundHeight;
-	height = groundHeight - buildingHeight - 2;
-	columns = maxColumn;
-	game = true;
-	endless = endlessAttack;
-	shieldLock = false;
-	quit = false;
-	defenseForce = defense;
+/// Function: releaseThreads
+///--------------------------
+/// De-allocates the stripe locks and the clock once no thread is using them
+///
+/// @param game the game being released
+
+void releaseThreads(Game * game){
+	assert(game != NULL);
+	for (int i = 0; i < game->stripeCount; i++)
+		plockDestroy(&game->stripes[i]);
+	free(game->stripes);
+	game->stripes = NULL;
+	game->stripeCount = 0;
+	if (game->clock != NULL)
+		destroyClock(game->clock);
+	game->clock = NULL;
+}
+
+/// Function: createMissileStore
+///------------------------------
+/// Creates a store for a number of missiles. The store and all of its
+/// arrays share one allocation, so recycling a slot never touches the heap.
+///
+/// @param capacity the number of missile slots
+/// @return MissileStore pointer to the dynamically allocated store object
+
+MissileStore * createMissileStore(size_t capacity){
+	size_t header = (sizeof(struct MissileStore_S) + 7) & ~(size_t)7; // keeps the arrays aligned
+	size_t size = header + capacity * (sizeof(Rng) + sizeof(Missile) + 3 * sizeof(int) + sizeof(bool));
+	char * block = malloc(size);
+	if (block == NULL)
+		return NULL;
+	MissileStore * new = (MissileStore *)block;
+	block += header;
+	new->rng = (Rng *)block; // widest fields first
+	block += capacity * sizeof(Rng);
+	new->handles = (Missile *)block;
+	block += capacity * sizeof(Missile);
+	new->height = (int *)block;
+	block += capacity * sizeof(int);
+	new->column = (int *)block;
+	block += capacity * sizeof(int);
+	new->delay = (int *)block;
+	block += capacity * sizeof(int);
+	new->exploded = (bool *)block;
+	new->game = NULL; // joined by the first createMissile
+	new->capacity = capacity;
+	new->count = 0;
+	for (size_t i = 0; i < capacity; i++){
+		new->handles[i].store = new;
+		new->handles[i].id = i;
+	}
+	return new;
+}
+
+/// Function: destroyMissileStore
+///-------------------------------
+/// De-allocates a store and every missile in it
+///
+/// @param store pointer to the store being freed
+
+void destroyMissileStore(MissileStore * store){
+	assert(store != NULL);
+	free(store); // the arrays live in the same block
 }
 
 /// Function: createMissile
 ///-------------------------
-/// Creates a new missile
+/// Creates a new missile in the next free slot of a store
 ///
+/// @param game the game the missile attacks; every missile of a store
+///        attacks the same game
+/// @param store the store holding the missile
 /// @param column the column value for the missile
 /// @param delay the amount of time the missile waits before starting to fall
-/// @return Missile pointer to the dynamically allocated missile object
-
-Missile * createMissile(int column, int delay){
-	Missile * new = malloc(sizeof(struct Missile_S));
-	if (new != 0){
-		new->height = 6;
-		new->column = column;
-		new->graphic = '|';
-		new->exploded = false;
-		new->delay = delay;
-	}
-	return new;
+/// @param stream the random stream the missile continues drawing from
+/// @return Missile handle for the slot, or NULL when the store is full
+
+Missile * createMissile(Game * game, MissileStore * store, int column, int delay, const Rng * stream){
+	assert(game != NULL && store != NULL);
+	assert(store->game == NULL || store->game == game);
+	store->game = game;
+	if (store->count == store->capacity)
+		return NULL;
+	size_t id = store->count++;
+	store->height[id] = LAUNCH_ROW;
+	store->column[id] = column;
+	store->exploded[id] = false;
+	store->delay[id] = delay;
+	store->rng[id] = *stream;
+	recordSpawn(game->record, id, column);
+	return &store->handles[id];
 }
 
 /// Function: resetMissile
 ///--------------------------
-/// Makes a missile object ready to fall again
+/// Makes a missile slot ready to fall again
 ///
-/// @param missile pointer to the missile object being reset
+/// @param missile handle of the missile being reset
 
 void resetMissile (Missile * missile){
 	assert(missile != NULL);
-	missile->height = 6;
-	missile->column = rand() % columns + 1;
-	missile->exploded = false;
+	MissileStore * store = missile->store;
+	size_t id = missile->id;
+	store->height[id] = LAUNCH_ROW;
+	store->column[id] = rngBelow(&store->rng[id], store->game->columns) + 1;
+	store->exploded[id] = false;
+	recordSpawn(store->game->record, id, store->column[id]);
 }
 
 /// Function: createShield
 ///------------------------
 /// Create a new shield.
 ///
+/// @param game the game the shield defends
+/// @param column the shield's left-most column
 /// @return Shield pointer to a dynamically allocated Shield object
 
-Shield * createShield( int column ){
+Shield * createShield( Game *game, int column ){
         Shield * new = malloc(sizeof(struct Shield_S));
         if (new != 0){
-                new->row = height;
+                new->game = game;
+                new->row = game->height;
                 new->column = column;
                 char * graphic = "#####";
                 new->graphic = graphic;
@@ -100,17 +244,6 @@ Shield * createShield( int column ){
         return new;
 }
 
-/// Function: destroyMissile
-///---------------------------
-/// De-allocates all dynamic memory for a specified missile object
-///
-/// @param missile pointer to the missile object being freed
-
-void destroyMissile(Missile * missile){
-	assert(missile != NULL);
-	free(missile);
-}
-
 /// Function: destroyShield 
 ///--------------------------
 /// Destroy all dynamically allocated storage for a shield.
@@ -122,97 +255,293 @@ void destroyShield( Shield *shield ){
         free(shield);
 }
 
-/// Function: eraseMissile
-///------------------------
-/// Erases the missile object graphic from the curses window
-///
-/// @param missile pointer to the missile being erases
-
-void eraseMissile(Missile * missile){
-	mvaddch(missile->height, missile->column, ' ');
-}
-
 /// Function: eraseShield
 ///-----------------------
-/// Erases the shield object graphic from the curses window
+/// Removes the shield from the collision grid before it moves
 ///
 /// @param shield pointer to the shield being erased
 
 void eraseShield(Shield * shield){
-        move(shield->row, shield->column);
-        clrtoeol();
+        occupancySpan(shield->game->grid, shield->row, shield->column, strlen(shield->graphic), CELL_EMPTY);
 }
 
 /// Function: drawMissile
 ///------------------------
-/// Adds the graphical representation of a missile object to the curses window
+/// Publishes where a missile fell to, so the render thread can draw it.
+/// Called once the missile's stripe is released; the event is dropped if
+/// the render thread has fallen a whole ring behind.
 ///
 /// @param missile pointer to the missile object being drawn
+/// @param from the row the missile was drawn on before it fell
 
-void drawMissile(Missile * missile){
-	mvaddch(missile->height, missile->column, missile->graphic);
+void drawMissile(Missile * missile, int from){
+	MissileStore * store = missile->store;
+	size_t id = missile->id;
+	if (store->exploded[id] == true)
+		renderMissileExploded(store->game->renderer, store->column[id], from, store->height[id]);
+	else
+		renderMissileMoved(store->game->renderer, store->column[id], from, store->height[id], MISSILE_GRAPHIC);
 }
 
 /// Function: drawShield
 ///-----------------------
-/// Adds the shields graphical representation to the curses window
+/// Adds the shield to the collision grid where it now stands; the caller
+/// publishes the move once its stripes are released
 ///
 /// @param shield pointer to the shield being drawn
 
 void drawShield(Shield * shield){
-        move(shield->row, shield->column);
-        addstr(shield->graphic);
+        occupancySpan(shield->game->grid, shield->row, shield->column, strlen(shield->graphic), CELL_SHIELD);
+}
+
+/// Function: showShield
+///--------------------
+/// Puts the shield in the collision grid and on the display where it starts
+///
+/// @param shield pointer to the shield being shown
+
+void showShield(Shield * shield){
+	int last = shield->column + strlen(shield->graphic) - 1;
+	lockColumns(shield->game, shield->column, last, true);
+	drawShield(shield);
+	unlockColumns(shield->game, shield->column, last);
+	renderShieldMoved(shield->game->renderer, shield->row, shield->column, shield->column, shield->graphic, 0);
 }
 
 /// Function: explode
 ///-------------------
-/// Updates the missile object, and curses window when the missile hit something
+/// Updates the missile object and the collision grid when the missile hit something
 ///
 /// @param missile pointer to the missile object that exploded
 
 void explode(Missile * missile){
-	missile->exploded = true;
-	mvaddch(missile->height, missile->column, '?');
-	mvaddch(missile->height + 1, missile->column, '*');
+	MissileStore * store = missile->store;
+	size_t id = missile->id;
+	if (store->exploded[id] == false)
+		statsCount(STAT_EXPLOSIONS);
+	store->exploded[id] = true;
+	occupancySet(store->game->grid, store->height[id], store->column[id], CELL_DEBRIS);
 }
 
-/// Function: advance
-///-------------------
-/// Moves a missile object one row down, and updates the object and curses window accordingly
+/// Function: settle
+///------------------
+/// Logs and tallies a missile's step once its new row is known; the caller
+/// publishes it with drawMissile and steer after releasing the missile's
+/// stripe
+///
+/// @param missile pointer to the missile that stepped
+/// @param hit what the missile struck, HIT_NONE if it is still falling
+
+static void settle(Missile * missile, Hit hit){
+	MissileStore * store = missile->store;
+	size_t id = missile->id;
+	if (hit != HIT_NONE)
+		__atomic_fetch_add(&store->game->hits[hit], 1, __ATOMIC_RELAXED); // workers share the tally
+	if (store->exploded[id] == true)
+		recordExplode(store->game->record, id, store->height[id]);
+}
+
+/// Function: steer
+///-----------------
+/// Tells the autopilot, if the game has one, where missiles that just
+/// stepped are headed. Each arrival at the shield's row is predicted from
+/// the mean fall delay, counted from the game time they stepped at. It is
+/// called after the stripes are released, so workers only meet at the
+/// autopilot's lock, once per batch.
+///
+/// @param store the store holding the missiles
+/// @param ids the missiles' slots
+/// @param count number of missiles, at most BATCH_SIZE
+/// @param now the game time in microseconds the missiles stepped at
+
+static void steer(MissileStore * store, const size_t * ids, size_t count, uint64_t now){
+	Game * game = store->game;
+	if (game->autopilot == NULL)
+		return;
+	int columns[BATCH_SIZE];
+	uint64_t arrivals[BATCH_SIZE];
+	for (size_t i = 0; i < count; i++){ // only this thread moves the missiles, so they are as they stepped
+		size_t id = ids[i];
+		columns[i] = store->column[id];
+		arrivals[i] = now + (uint64_t)(game->height - store->height[id]) * (MAX_SPEED_DELAY / 2);
+		if (store->exploded[id] == true || store->height[id] >= game->height)
+			columns[i] = AUTOPILOT_FORGET;
+	}
+	autopilotUpdate(game->autopilot, ids, columns, arrivals, count);
+}
+
+/// Function: step
+///----------------
+/// Moves a missile one row down and handles whatever it hits; this is the
+/// reference every batched step must agree with. The caller holds the
+/// missile's stripe.
 ///
 /// @param missile pointer to the missile object being advanced
 
-void advance(Missile * missile){
-	while(shieldLock == true) // gives the shield priority to the lock
-		usleep(10000); 
-	pthread_mutex_lock(&lock);
-	eraseMissile(missile);
-	char next = mvinch(missile->height + 1, missile->column);
+static void step(Missile * missile){
+	MissileStore * store = missile->store;
+	size_t id = missile->id;
+	Game * game = store->game;
+	recordStep(game->record, id); // under the stripe lock, so the log keeps each stripe's order
+	Cell next = occupancyAt(game->grid, store->height[id] + 1, store->column[id]);
+	Hit hit = HIT_NONE;
 
-	if (next == '_' || next == '|'){ //hits a building
-		missile->height++;
+	if (next == CELL_BUILDING){ //hits a building
+		store->height[id]++;
 		explode(missile);
-	} else if (next == '#') // hits the shield
+		hit = store->height[id] >= game->ground ? HIT_GROUND : HIT_BUILDING;
+	} else if (next == CELL_SHIELD){ // hits the shield
 		explode(missile);
-	else if (next == '?'){ // hits a previous missile
-		if (missile->height + 2 == height || missile->height + 1 == ground){ // hits a previous missile that hit the shield or the ground
-			missile->height++;
+		hit = HIT_SHIELD;
+	} else if (next == CELL_DEBRIS){ // hits a previous missile
+		hit = HIT_DEBRIS;
+		if (store->height[id] + 2 == game->height || store->height[id] + 1 == game->ground){ // hits a previous missile that hit the shield or the ground
+			store->height[id]++;
 			explode(missile);
-		} else { // hits the building
-			missile->height++;
-			eraseMissile(missile);
-			missile->height++;
+		} else { // hits the building, falling through the debris
+			occupancySet(game->grid, store->height[id] + 1, store->column[id], CELL_EMPTY); // the debris it fell through is gone
+			store->height[id] += 2;
 			explode(missile);
 		}
 	} else { // continues to fall
-		missile->height++;
+		store->height[id]++;
 	}
-	if (missile->height >= ground)
+	if (store->height[id] >= game->ground){
 		explode(missile);
-	if (missile->exploded == false)
-		drawMissile(missile);
-	refresh();
-	pthread_mutex_unlock(&lock);
+		if (hit == HIT_NONE)
+			hit = HIT_GROUND;
+	}
+	settle(missile, hit);
+}
+
+/// Function: advance
+///-------------------
+/// Moves a missile object one row down, and updates the object and curses window accordingly
+///
+/// @param missile pointer to the missile object being advanced
+/// @param now the game time in microseconds of the step
+
+void advance(Missile * missile, uint64_t now){
+	Game * game = missile->store->game;
+	PriorityLock * stripe = &game->stripes[columnStripe(game, missile->store->column[missile->id])];
+	int from = missile->store->height[missile->id];
+	plockAcquire(stripe, false); // the shield goes first when it is waiting
+	step(missile);
+	plockRelease(stripe);
+	drawMissile(missile, from); // only this thread moves the missile, so it is still as step() left it
+	steer(missile->store, &missile->id, 1, now);
+	statsCount(STAT_ADVANCES);
+}
+
+/// Function: sortStripes
+///-----------------------
+/// Sorts stripe indices with a byte-at-a-time radix sort, which for a
+/// batch's few hundred keys is far cheaper than qsort's indirect compares
+///
+/// @param keys the indices being sorted, none negative
+/// @param scratch space for as many indices as keys
+/// @param count number of indices
+
+static void sortStripes(int * keys, int * scratch, size_t count){
+	int largest = 0;
+	for (size_t i = 0; i < count; i++)
+		if (keys[i] > largest)
+			largest = keys[i];
+	for (int shift = 0; shift < 32 && (largest >> shift) != 0; shift += 8){
+		size_t place[257] = { 0 };
+		for (size_t i = 0; i < count; i++)
+			place[((keys[i] >> shift) & 0xff) + 1]++;
+		for (int digit = 0; digit < 256; digit++)
+			place[digit + 1] += place[digit];
+		for (size_t i = 0; i < count; i++)
+			scratch[place[(keys[i] >> shift) & 0xff]++] = keys[i];
+		memcpy(keys, scratch, count * sizeof(int));
+	}
+}
+
+/// Function: advanceChunk
+///------------------------
+/// Steps up to BATCH_SIZE missiles under one acquisition of their stripes.
+/// A chunk spread too thin to share its stripes takes nearly a lock per
+/// missile anyway, so it is stepped one missile at a time instead.
+///
+/// @param store the store holding the missiles
+/// @param ids the missiles' slots, stepped in this order
+/// @param count number of missiles, at most BATCH_SIZE
+/// @param now the game time in microseconds of the step
+
+static void advanceChunk(MissileStore * store, const size_t * ids, size_t count, uint64_t now){
+	Game * game = store->game;
+	int from[BATCH_SIZE], column[BATCH_SIZE], next[BATCH_SIZE], hits[BATCH_SIZE];
+	int locked[BATCH_SIZE], lockCount = 0;
+	for (size_t i = 0; i < count; i++){ // gathers the batch into contiguous arrays
+		from[i] = store->height[ids[i]];
+		column[i] = store->column[ids[i]];
+		locked[i] = columnStripe(game, column[i]);
+	}
+	sortStripes(locked, next, count); // next is free until the kernel runs
+	for (size_t i = 0; i < count; i++)
+		if (lockCount == 0 || locked[lockCount - 1] != locked[i])
+			locked[lockCount++] = locked[i];
+	if ((size_t)lockCount * BATCH_DENSITY > count){ // too few missiles share a stripe to pay for the kernel
+		for (size_t i = 0; i < count; i++)
+			advance(&store->handles[ids[i]], now);
+		return;
+	}
+	for (int i = 0; i < lockCount; i++) // ascending, like lockColumns
+		plockAcquire(&game->stripes[locked[i]], false);
+
+	batchClassify(game->grid, game->ground, game->height, from, column, count, next, hits);
+	int burst[BATCH_SIZE], burstCount = 0; // columns an earlier missile in this chunk left debris in
+	for (size_t i = 0; i < count; i++){
+		Missile * missile = &store->handles[ids[i]];
+		bool stale = false;
+		for (int j = 0; j < burstCount && stale == false; j++)
+			stale = burst[j] == column[i];
+		if (stale == true) // the grid changed under the kernel's answer; step() clears burrowed debris itself
+			step(missile);
+		else {
+			recordStep(game->record, ids[i]);
+			store->height[ids[i]] = next[i];
+			if (next[i] == from[i] + 2) // fell through debris, which is gone now, as in step()
+				occupancySet(game->grid, from[i] + 1, column[i], CELL_EMPTY);
+			if (hits[i] != HIT_NONE)
+				explode(missile);
+			settle(missile, hits[i]);
+		}
+		if (store->exploded[ids[i]] == true && stale == false)
+			burst[burstCount++] = column[i];
+	}
+
+	for (int i = lockCount - 1; i >= 0; i--)
+		plockRelease(&game->stripes[locked[i]]);
+	for (size_t i = 0; i < count; i++)
+		drawMissile(&store->handles[ids[i]], from[i]);
+	steer(store, ids, count, now);
+	statsAdd(STAT_ADVANCES, count);
+}
+
+/// Function: advanceBatch
+///------------------------
+/// Moves every missile of a batch one row down, the same as calling
+/// advance() on each in turn
+///
+/// @param store the store holding the missiles
+/// @param ids the missiles' slots
+/// @param count number of missiles
+/// @param now the game time in microseconds of the step
+
+void advanceBatch(MissileStore * store, const size_t * ids, size_t count, uint64_t now){
+	assert(store != NULL);
+	size_t sparse = (size_t)(store->game->stripeCount - 1) * BATCH_DENSITY; // the last stripe is the shield's spare
+	for (size_t done = 0; done < count; done += BATCH_SIZE){
+		size_t chunk = count - done < BATCH_SIZE ? count - done : BATCH_SIZE;
+		if (chunk < sparse) // spread evenly, the chunk could not be dense enough, so the sort is skipped too
+			for (size_t i = 0; i < chunk; i++)
+				advance(&store->handles[ids[done + i]], now);
+		else
+			advanceChunk(store, ids + done, chunk, now);
+	}
 }
 
 /// Function: advanceShield
@@ -221,31 +550,71 @@ void advance(Missile * missile){
 ///
 /// @param shield pointer to the shield object being moved
 /// @param left true == move left, false == move right
-
-void advanceShield(Shield * shield, bool left){
-	shieldLock = true;
-        pthread_mutex_lock(&lock);
+/// @param stamp when the key asking for the move was read
+
+void advanceShield(Shield * shield, bool left, uint64_t stamp){
+        int width = strlen(shield->graphic);
+        int first = left == true ? shield->column - 1 : shield->column; // the span before and after the move
+        int last = shield->column + width - (left == true ? 1 : 0);
+        Game * game = shield->game;
+        lockColumns(game, first, last, true);
+        statsCount(STAT_SHIELD_MOVES);
+        int from = shield->column;
         eraseShield(shield);
         if (left == true){
                 if (shield->column > 0)
                         shield->column--;
-                drawShield(shield);
         } else {
-                if (shield->column < columns)
+                if (shield->column < game->columns)
                         shield->column++;
-                drawShield(shield);
         }
-        refresh();
-        pthread_mutex_unlock(&lock);
-	shieldLock = false;
+        drawShield(shield);
+        int to = shield->column;
+        if (to != from)
+                recordShield(game->record, to);
+        unlockColumns(game, first, last);
+        renderShieldMoved(game->renderer, shield->row, from, to, shield->graphic, stamp); // the render ring may make this wait, so not under the stripes
 }
 
 /// Function: endGame
 ///-------------------
 /// Informs the shield thread that the game has ended
+///
+/// @param game the game whose attack is over
 
-void endGame(){
-        game = false;
+void endGame(Game * game){
+        __atomic_store_n(&game->attacking, false, __ATOMIC_RELEASE); // read by the shield thread
+	clockWake(game->clock); // an autopilot may be asleep until its next move
+}
+
+/// Function: nextFallDelay
+///-------------------------
+/// Picks the random time a missile waits before falling another row
+///
+/// @param missile pointer to the falling missile
+/// @return the delay in microseconds
+
+long nextFallDelay(Missile * missile){
+	assert(missile != NULL);
+	return rngBelow(&missile->store->rng[missile->id], MAX_SPEED_DELAY + 1);
+}
+
+/// Function: gameLockStats
+///-------------------------
+/// Adds up how long threads have waited for and held the stripe locks
+///
+/// @param game the game whose locks are read
+/// @param stats where the timings are stored
+
+void gameLockStats(Game * game, PriorityLockStats * stats){
+	PriorityLockStats stripe;
+	stats->acquires = stats->waitNs = stats->holdNs = 0;
+	for (int i = 0; i < game->stripeCount; i++){
+		plockStats(&game->stripes[i], &stripe);
+		stats->acquires += stripe.acquires;
+		stats->waitNs += stripe.waitNs;
+		stats->holdNs += stripe.holdNs;
+	}
 }
 
 /// Function: run
@@ -260,14 +629,17 @@ void *run( void *missile){
         assert(missile != NULL); // missile cannot be NULL
         long delay;
         Missile* missileData = missile;
+	Clock * clock = missileData->store->game->clock;
 
-	usleep(missileData->delay); // increments the missiles
+	clockJoin(clock); // the thread's delays hold fast mode's time back
+	clockDelay(clock, missileData->store->delay[missileData->id]); // increments the missiles
 
-	while (missileData->exploded == false){
-		delay = rand() % (MAX_SPEED_DELAY + 1);
-		usleep(delay);
-		advance(missileData);
+	while (missileData->store->exploded[missileData->id] == false && clockCancelled(clock) == false){
+		delay = nextFallDelay(missileData);
+		clockDelay(clock, delay);
+		advance(missileData, clockNow(clock));
 	}
+	clockLeave(clock);
 	pthread_exit(NULL);
 }
 
@@ -283,34 +655,84 @@ void *runShield( void *shield ){
         assert(shield != NULL);
 	int ch;
         Shield * shieldData = shield;
-	pthread_mutex_lock(&lock);
-	if (endless == true) // prompts the user with the correct exit instructions
-		mvprintw(0, 6, "%s", "Endless Attack Mode. Enter control-C to quit.");
+        Game * game = shieldData->game;
+	if (game->endless == true) // prompts the user with the correct exit instructions
+		renderPrint(game->renderer, 0, 6, "%s", "Endless Attack Mode. Enter '?' or control-C to quit.");
 	else
-		mvprintw(0, 6, "%s", "Enter '?' to quit at end of attack, or control-C.");
-	drawShield(shieldData); // displays the shield on the curses window
-	refresh();
-	pthread_mutex_unlock(&lock);
-        while (game == true || quit == false){
-                ch = getch();
+		renderPrint(game->renderer, 0, 6, "%s", "Enter '?' to quit at end of attack, or control-C.");
+	if (displayInteractive() == false) // nobody can steer a headless shield
+		pthread_exit(NULL);
+        while ((__atomic_load_n(&game->attacking, __ATOMIC_ACQUIRE) == true ||
+			__atomic_load_n(&game->quit, __ATOMIC_ACQUIRE) == false) && clockCancelled(game->clock) == false){
+                ch = displayKey();
                 switch(ch){
-                        case KEY_LEFT:
-                                advanceShield(shieldData, true);
+                        case DISPLAY_KEY_LEFT:
+                                advanceShield(shieldData, true, displayKeyTime());
                                 break;
-                        case KEY_RIGHT:
-                                advanceShield(shieldData, false);
+                        case DISPLAY_KEY_RIGHT:
+                                advanceShield(shieldData, false, displayKeyTime());
                                 break;
 			case '?': // the user entered '?'
-				quit = true;
+				__atomic_store_n(&game->quit, true, __ATOMIC_RELEASE);
+				if (game->endless == true)
+					clockCancel(game->clock); // an endless attack only ends when it is called off
 				break;
                         default:
                                 break;
                 }
         }
-	mvprintw(5, 6, "The %s defense has ended.", defenseForce);
-        mvprintw(6, 6, "%s", "hit enter to close...");
-	while (ch != 13 && ch != 10){
-		ch = getch();
+	renderPrint(game->renderer, 5, 6, "The %s defense has ended.", game->defenseForce);
+	if (clockCancelled(game->clock) == true) // nobody waits on a game that was called off
+		pthread_exit(NULL);
+        renderPrint(game->renderer, 6, 6, "%s", "hit enter to close...");
+	while (ch != 13 && ch != 10 && clockCancelled(game->clock) == false){
+		ch = displayKey();
 	}
         pthread_exit(NULL);
 }
+
+/// Function: runAutopilot
+/// ----------------------
+///  The 'main method' for a shield thread steered by the autopilot. Moves
+///  fall half a wheel tick after the missile steps, so a fast clock never
+///  runs the two at the same instant.
+///
+/// @param shield Shield object declared as void* for pthread operability
+/// @return void pointer to status. A NULL represents success.
+/// @pre the game has an autopilot, and the thread has joined the clock.
+
+void *runAutopilot( void *shield ){
+	assert(shield != NULL);
+	Shield * shieldData = shield;
+	Game * game = shieldData->game;
+	assert(game->autopilot != NULL);
+	int width = strlen(shieldData->graphic);
+	if (game->endless == true)
+		renderPrint(game->renderer, 0, 6, "%s", "Endless Attack Mode on autopilot. Enter control-C to quit.");
+	else
+		renderPrint(game->renderer, 0, 6, "%s", "The shield is on autopilot.");
+	uint64_t next = clockNow(game->clock) / AUTOPILOT_PERIOD * AUTOPILOT_PERIOD + TICK_US / 2;
+	for (;;){
+		next += AUTOPILOT_PERIOD;
+		uint64_t epoch = clockEpoch(game->clock); // before the check, so endGame's wake is not missed
+		while (__atomic_load_n(&game->attacking, __ATOMIC_ACQUIRE) == true && clockNow(game->clock) < next){
+			clockSleep(game->clock, next, epoch);
+			epoch = clockEpoch(game->clock);
+		}
+		if (__atomic_load_n(&game->attacking, __ATOMIC_ACQUIRE) == false || clockCancelled(game->clock) == true)
+			break;
+		autopilotTime(game->autopilot, next);
+		int target = autopilotTarget(game->autopilot, shieldData->column, width);
+		if (target != shieldData->column)
+			advanceShield(shieldData, target < shieldData->column, 0);
+	}
+	clockLeave(game->clock);
+	renderPrint(game->renderer, 5, 6, "The %s defense has ended.", game->defenseForce);
+	if (displayInteractive() == true && clockCancelled(game->clock) == false){
+		renderPrint(game->renderer, 6, 6, "%s", "hit enter to close...");
+		int ch = 0;
+		while (ch != 13 && ch != 10 && clockCancelled(game->clock) == false)
+			ch = displayKey();
+	}
+	pthread_exit(NULL);
+}
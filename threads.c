@@ -7,139 +7,157 @@
 #define _DEFAULT_SOURCE
 #define MAX(a,b) 	((a < b) ? (b) : (a))
 #define MIN(a,b)	((a > b) ? (b) : (a))
+#define HEADLESS_ROWS	24
+#define HEADLESS_COLS	80
+#define DEFAULT_DENSITY	20
+#define DEFAULT_SPAWN_RATE	1.0
+#define DEFAULT_STATS_FILE	"threads.stats"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
 #include <stdbool.h>
-#include <ctype.h>
 #include <assert.h>
-#include <curses.h>
+#include <getopt.h>
 #include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
 #include "threads.h"
+#include "config.h"
+#include "display.h"
+#include "render.h"
+#include "rng.h"
+#include "pool.h"
+#include "stats.h"
+#include "record.h"
+#include "montecarlo.h"
+#include "clock.h"
+#include "mirror.h"
 
-/// Global variables used by the game
-char * defenseForce;
-char * attackForce;
-size_t missileCount;
-int maxHeight;
-int tallestBuilding;
-int maxWidth;
-int * heights;
-size_t arraySize;
-size_t column;
-volatile bool attack;
+static int caught; // the signal that called the game off, 0 if none did
+static Clock * watched; // the clock a signal cancels, NULL until the game has one
 
-/// Function: gameBuilder
-///-----------------------
-/// Takes the provided config-file and attempts to build the game
+/// Function: watchSignals
+///------------------------
+/// Main method for the thread that takes SIGINT and SIGTERM. Every other
+/// thread blocks them, so they are received here by sigwait, outside any
+/// signal handler, and can safely cancel the clock and wake the shield
+/// thread. Each thread then stops at its next check and the game unwinds
+/// through the normal exit path, closing the display.
 ///
-/// @param fp file pointer to the configuration file
-/// @returns true/false whether the game was build successfully
+/// @param set the signals being waited for
+/// @return NULL, once the thread is cancelled
 
-bool gameBuilder(FILE * fp){
-	
-	size_t len = 0;
-	char * line = NULL;
-	ssize_t nread;
-	size_t lineCount = 0;
-	char * token;
-	size_t height;
-	bool valid = true;
-	heights = malloc(arraySize * sizeof(int));
+static void *watchSignals(void *set){
+	int signal;
+	for (;;){
+		if (sigwait(set, &signal) != 0)
+			continue;
+		__atomic_store_n(&caught, signal, __ATOMIC_SEQ_CST);
+		Clock * clock = __atomic_load_n(&watched, __ATOMIC_SEQ_CST);
+		if (clock != NULL)
+			clockCancel(clock);
+		displayInterrupt();
+	}
+	return NULL;
+}
+
+/// Function: watchClock
+///----------------------
+/// Hands the game's clock to watchSignals, cancelling it at once if a
+/// signal was caught before the clock existed
+///
+/// @param clock the game's clock, NULL before it is destroyed
 
-	while((nread = getline(&line, &len, fp)) > 0 && valid == true){
-		if (line[0] == '#')
+static void watchClock(Clock * clock){
+	__atomic_store_n(&watched, clock, __ATOMIC_SEQ_CST);
+	if (clock != NULL && __atomic_load_n(&caught, __ATOMIC_SEQ_CST) != 0)
+		clockCancel(clock); // the watcher may have looked before the store
+}
+
+/// Function: drawCity
+///--------------------
+/// Puts a piece of the city into the renderer's scene, for occupancyCity
+///
+/// @param renderer the Renderer declared as void*
+/// @param row the row of the piece
+/// @param col the world column of the piece
+/// @param ch the piece's character
+
+static void drawCity(void * renderer, int row, int col, char ch){
+	sceneSet(renderer, row, col, ch);
+}
+
+/// Function: replayGame
+///----------------------
+/// Re-runs a recorded game by applying its log in order on the calling
+/// thread, checking every explosion and shield move against the log. Each
+/// record waits for its recorded time on the virtual clock, so the clock's
+/// speed sets the pace of the replay.
+///
+/// @param replay the log being replayed
+/// @param missiles the store the log's missile slots are created in
+/// @param shield the shield the log moves
+/// @return the number of records that did not match the replayed game
+
+size_t replayGame(Replay * replay, MissileStore * missiles, Shield * shield){
+	Record record;
+	Rng unused; // replayed columns come from the log, not a stream
+	rngSeed(&unused, 0, 0);
+	size_t mismatches = 0, records = 0;
+	Clock * clock = shield->game->clock;
+	clockJoin(clock);
+	uint64_t start = clockNow(clock);
+	while (clockCancelled(clock) == false && replayNext(replay, &record) == true){
+		records++;
+		while (clockNow(clock) < start + record.time && clockCancelled(clock) == false)
+			clockSleep(clock, start + record.time, clockEpoch(clock));
+		if (clockCancelled(clock) == true)
+			break; // the record is not applied, so it is not counted
+
+		if (record.kind != RECORD_SHIELD && record.id > missiles->count){
+			mismatches++; // a slot the log never spawned
 			continue;
-		switch (lineCount){
-			case 0:
-				if (nread <= 80){
-					defenseForce = malloc(nread * sizeof(char));
-					strncpy(defenseForce, line, nread - 1);
-					lineCount++;
+		}
+		Missile * missile = &missiles->handles[record.id];
+		switch (record.kind){
+			case RECORD_SPAWN:
+				if (record.id == missiles->count){
+					if (createMissile(shield->game, missiles, record.value, 0, &unused) == NULL)
+						mismatches++; // more slots than the header declared, so the store is full
 				} else {
-					fprintf(stderr, "%s", "Error: missing defender name.\n");
-					if (line != NULL)
-						free(line);
-					return false;
+					resetMissile(missile);
+					missiles->column[record.id] = record.value;
 				}
 				break;
-			case 1:
-				if (nread <= 80){
-					attackForce = malloc(nread * sizeof(char));
-					strncpy(attackForce, line, nread - 1);
-					lineCount++;
-				} else {
-					fprintf(stderr, "%s", "Error: missing attacker name.\n");
-					if (line != NULL)
-						free(line);
-					return false;
-				}
+			case RECORD_STEP:
+				if (record.id == missiles->count || missiles->exploded[record.id] == true)
+					mismatches++;
+				else
+					advance(missile, clockNow(clock));
 				break;
-			case 2:
-				for (ssize_t i = 0; i < nread; i++){
-					if (isdigit(line[i]) == 0 && isspace(line[i]) == 0){
-						if (line != NULL)
-                                                	free(line);
-						fprintf(stderr, "%s", "Error: missing missile specification.\n");
-                                        	return false;
-					}
-				}
-				if (valid == true){
-					missileCount = atoi(line);
-					lineCount++;
-				}
+			case RECORD_EXPLODE:
+				if (record.id == missiles->count || missiles->exploded[record.id] == false ||
+						missiles->height[record.id] != record.value)
+					mismatches++;
 				break;
-			default:
-				token = strtok(line, " ");
-				while (token != NULL){
-					for (size_t i = 0; i < strlen(token); i++){
-						if (isdigit(token[i]) == 0 && isspace(token[i]) == 0){
-							if (line != NULL)
-                                                		free(line);
-							fprintf(stderr, "%s", "Error: missing city layout.\n");
-                                        		return false;
-						}
-					}
-					height = atoi(token);
-					if (column == arraySize){ // reallocates array when it's full
-						arraySize *= 2;
-						heights = realloc(heights, arraySize * sizeof(int));
+			case RECORD_SHIELD:
+				while (shield->column != record.value){
+					int from = shield->column;
+					advanceShield(shield, record.value < from, 0);
+					if (shield->column == from){ // the shield is against an edge
+						mismatches++;
+						break;
 					}
-					heights[column] = height;
-					column++;
-					token = strtok(NULL, " ");
 				}
 				break;
 		}
 	}
-	if (line != NULL)
-		free(line);
-	switch (lineCount){
-		case 0:
-			fprintf(stderr, "%s", "Error: missing defender name.\n");
-			return false;
-		case 1:
-			fprintf(stderr, "%s", "Error: missing attacker name.\n");
-                        return false;
-		case 2:
-			fprintf(stderr, "%s", "Error: missing missile specification.\n");
-                        return false;
-		default:
-			return valid;
-	}	
-}
-
-/// Function: restartAttack
-///-------------------------
-/// Resets all missile objects to continue attack for unlimited missile loop
-///
-/// @param missiles array containing all created missile objects
-
-void restartAttack(Missile ** missiles){
-	assert (missiles != NULL);
-	for (size_t i = 0; i < missileCount; i++)
-		resetMissile(missiles[i]);
+	clockLeave(clock);
+	fprintf(stderr, "replay: %zu records, %zu mismatched\n", records, mismatches);
+	return mismatches;
 }
 
 /// Function: main
@@ -148,126 +166,363 @@ void restartAttack(Missile ** missiles){
 ///
 /// @param argc number of commandline arguments
 /// @param argv array of commandline argument strings
-/// @return 0 if success, else EXIT_FAILURE
+/// @return 0 if success, 128 plus the signal if one ended the game, else EXIT_FAILURE
 
 int main(int argc, char* argv[]){
-	missileCount = 0; // initializes missileCount variable
-	arraySize = 256;
-	tallestBuilding = 0;
-	char * usage = "./threads config-file\n";
-	attack = true;
-	int height, previousHeight = 2;
+	Config config; // everything the config-file specifies
+	Game game; // the one game this program plays
+	size_t missileCount;
+	int maxHeight, maxWidth;
+	int worldWidth; // columns in the simulated world, at least the display's width
+	int tallestBuilding;
+	char * usage = "./threads [-t pool-size] [-f fps] [-q queue-size] [-s seed] [-d density] [-r spawn-rate] [--headless | --ansi] [--autopilot] [--stats file] [--speed factor | --fast] [--record file | --replay file] [--mirror name] config-file\n"
+			"./threads --batch runs [--shield idle|chase|autopilot] [-t threads] [-s seed] [-d density] config-file...\n";
 	Shield * shield;
-	Missile ** missiles;
-	pthread_t * threads;
-	bool valid = true, endless;
-	int delay = 0;
-	srand(time(NULL)); //  Seeding random number generator
-	if (argc != 2){
+	MissileStore * missiles;
+	Pool * pool;
+	Occupancy * grid;
+	Renderer * renderer;
+	Mirror * mirror = NULL;
+	Autopilot * pilot = NULL;
+	size_t poolSize = 0; // 0 sizes the pool to the core count
+	int fps = DEFAULT_FPS;
+	size_t queueSize = DEFAULT_QUEUE;
+	RingStats events;
+	uint64_t seed = time(NULL); // a fixed seed makes the run reproducible
+	Rng stream;
+	size_t density = DEFAULT_DENSITY; // endless mode missiles in flight
+	double spawnRate = DEFAULT_SPAWN_RATE; // endless mode missiles launched per second
+	const char * statsFile = DEFAULT_STATS_FILE; // where SIGUSR1 dumps the instrumentation
+	const char * recordFile = NULL; // where the session is logged
+	const char * replayFile = NULL; // the log being replayed instead of playing
+	const char * mirrorName = NULL; // the shared-memory segment spectators read
+	Replay * replay = NULL;
+	RecordHeader header;
+	sigset_t stopSignals; // taken by watchSignals instead of ending the process
+	pthread_t signalThread;
+	double speed = 1.0; // virtual seconds per real second, CLOCK_FAST for as fast as possible
+	size_t runs = 0; // games played per config-file in batch mode
+	ShieldScript script = SCRIPT_CHASE; // how a batch game's shield is steered
+	size_t mismatches = 0;
+	bool valid = true, endless, headless = false, ansi = false, autopilot = false;
+	int delay = 0, opt;
+	struct option options[] = {
+		{ "threads", required_argument, NULL, 't' },
+		{ "fps", required_argument, NULL, 'f' },
+		{ "queue", required_argument, NULL, 'q' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "density", required_argument, NULL, 'd' },
+		{ "spawn-rate", required_argument, NULL, 'r' },
+		{ "headless", no_argument, NULL, 'h' },
+		{ "ansi", no_argument, NULL, 'A' },
+		{ "autopilot", no_argument, NULL, 'O' },
+		{ "stats", required_argument, NULL, 'S' },
+		{ "record", required_argument, NULL, 'R' },
+		{ "replay", required_argument, NULL, 'P' },
+		{ "speed", required_argument, NULL, 'V' },
+		{ "fast", no_argument, NULL, 'F' },
+		{ "mirror", required_argument, NULL, 'M' },
+		{ "batch", required_argument, NULL, 'B' },
+		{ "shield", required_argument, NULL, 'D' },
+		{ NULL, 0, NULL, 0 }
+	};
+	while ((opt = getopt_long(argc, argv, "t:f:q:s:d:r:", options, NULL)) != -1){
+		switch (opt){
+			case 't': // number of worker threads driving the missiles
+				if (atoi(optarg) <= 0){
+					fprintf(stderr, "%s", "Error: pool size must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				poolSize = atoi(optarg);
+				break;
+			case 'f': // maximum display refreshes per second
+				fps = atoi(optarg);
+				if (fps <= 0){
+					fprintf(stderr, "%s", "Error: frame rate must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'q': // event slots between the game and the render thread
+				if (atoi(optarg) <= 0){
+					fprintf(stderr, "%s", "Error: queue size must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				queueSize = atoi(optarg);
+				break;
+			case 's': // seeds every missile's random stream
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'd': // missiles in flight during an endless attack
+				if (atoi(optarg) <= 0){
+					fprintf(stderr, "%s", "Error: density must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				density = atoi(optarg);
+				break;
+			case 'r': // missiles launched per second during an endless attack
+				spawnRate = atof(optarg);
+				if (spawnRate <= 0){
+					fprintf(stderr, "%s", "Error: spawn rate must be a positive number.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'h': // renders into memory instead of the terminal
+				headless = true;
+				break;
+			case 'A': // draws with escape sequences instead of curses
+				ansi = true;
+				break;
+			case 'O': // steers the shield without a player
+				autopilot = true;
+				break;
+			case 'S': // the file SIGUSR1 dumps the instrumentation to
+				statsFile = optarg;
+				break;
+			case 'R': // logs the session for replaying later
+				recordFile = optarg;
+				break;
+			case 'P': // replays a logged session instead of playing
+				replayFile = optarg;
+				break;
+			case 'M': // publishes the game for spectators in other processes
+				mirrorName = optarg;
+				break;
+			case 'V': // runs the game's clock faster or slower than real time
+				speed = atof(optarg);
+				if (speed <= 0){
+					fprintf(stderr, "%s", "Error: speed must be a positive number.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'F': // plays without a terminal, as fast as possible
+				speed = CLOCK_FAST;
+				headless = true;
+				break;
+			case 'B': // plays each config-file many times in simulated time
+				if (atoi(optarg) <= 0){
+					fprintf(stderr, "%s", "Error: the batch run count must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				runs = atoi(optarg);
+				break;
+			case 'D': // steers the shield of a batch game
+				if (strcmp(optarg, "idle") == 0)
+					script = SCRIPT_IDLE;
+				else if (strcmp(optarg, "chase") == 0)
+					script = SCRIPT_CHASE;
+				else if (strcmp(optarg, "autopilot") == 0)
+					script = SCRIPT_AUTOPILOT;
+				else {
+					fprintf(stderr, "%s", "Error: the shield script must be idle, chase or autopilot.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				fprintf(stderr, "%s", usage);
+				return EXIT_FAILURE;
+		}
+	}
+	if (runs > 0){ // no display, no renderer, just outcomes
+		if (optind == argc || recordFile != NULL || replayFile != NULL || mirrorName != NULL){
+			fprintf(stderr, "%s", usage);
+			return EXIT_FAILURE;
+		}
+		BatchOptions batch = { runs, poolSize, seed, density, script };
+		return runBatch(argv + optind, argc - optind, &batch, stdout) == true ? 0 : EXIT_FAILURE;
+	}
+	if (argc - optind != 1 || (recordFile != NULL && replayFile != NULL) ||
+			(autopilot == true && replayFile != NULL)){
 		fprintf(stderr, "%s", usage);
 		return EXIT_FAILURE;
 	}
-	char * fileName = argv[1];
-	FILE * fp = fopen(fileName, "r");
-	if (fp == NULL){
-		fprintf(stderr, "%s", "Error: specified config-file not found.\n");
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGINT);
+	sigaddset(&stopSignals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stopSignals, NULL); // before any thread starts, so all of them inherit it
+	pthread_create(&signalThread, NULL, &watchSignals, &stopSignals);
+	char * fileName = argv[optind];
+	if (parseConfig(fileName, &config) == false) // creates the game
 		return EXIT_FAILURE;
+	missileCount = config.missiles;
+	if (replayFile != NULL){
+		replay = createReplay(replayFile, &header);
+		if (replay == NULL || header.columns != config.columns){
+			fprintf(stderr, "%s", replay == NULL ? "Error: unable to read the replay log.\n" :
+					"Error: the replay log was recorded with a different city.\n");
+			if (replay != NULL)
+				destroyReplay(replay);
+			freeConfig(&config);
+			return EXIT_FAILURE;
+		}
+		seed = header.seed;
 	}
-	valid = gameBuilder(fp); // creates the game
-	fclose(fp); // closes the config-file
+	if (headless == true)
+		valid = openGridDisplay(HEADLESS_ROWS, HEADLESS_COLS);
+	else
+		valid = ansi == true ? openAnsiDisplay() : openCursesDisplay();
 	if (valid == false){
-		if (heights != NULL)
-			free(heights);
+		fprintf(stderr, "%s", "Error: unable to open the display.\n");
+		freeConfig(&config);
 		return EXIT_FAILURE;
 	}
-	initscr(); // initializes stdscr, a curses global variable
-	cbreak();
-	noecho(); // disables typed characters appearing in terminal
-	keypad(stdscr, TRUE);
-	maxWidth = getmaxx(stdscr);
-	maxHeight = getmaxy(stdscr);
-	for (size_t i = 0; i < column; i++){ // displays the specified city in the terminal
-		height = heights[i];
-		if (height > tallestBuilding)
-			tallestBuilding = height;
-		if (height != previousHeight){
-			for (int x = 2; x < MAX(height, previousHeight); x++){
-				if (i > 0)
-					mvaddch(maxHeight - x, i, '|');
-			}
-		} else
-			mvaddch(maxHeight - height, i, '_');
-		previousHeight = height;
+	maxWidth = displayCols();
+	maxHeight = replay != NULL ? header.rows : displayRows(); // a replay needs the recorded ground row
+	worldWidth = MAX((int)config.columns, maxWidth) + 1;
+	grid = createOccupancy(maxHeight, worldWidth);
+	renderer = createRenderer(maxHeight, worldWidth);
+	if (grid == NULL || renderer == NULL){
+		closeDisplay();
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+		if (grid != NULL)
+			destroyOccupancy(grid);
+		if (renderer != NULL)
+			destroyRenderer(renderer);
+		freeConfig(&config);
+		return EXIT_FAILURE;
 	}
-	for (int i = MIN((int)column, maxWidth) - 1; i <= MAX((int)column, maxWidth); i++)
-		mvaddch(maxHeight - 2, i, '_');
-	refresh();
-	getch();
+	tallestBuilding = occupancyCity(grid, config.heights, config.columns, &drawCity, renderer); // the whole specified city, however wide
+	sceneShow(renderer, (config.columns / 2) + 3); // the part of the city the shield starts over
+	if (headless == false)
+		displayKey(); // waits for the player to start the game
+	statsWatch(statsFile);
+	startRenderer(renderer, fps, queueSize); // from here on only the render thread touches the display
 	if (missileCount == 0)
 		endless = true;
 	else
 		endless = false;
-	initThreads(maxHeight - 2, tallestBuilding, column, defenseForce, endless);
+	if (initThreads(&game, maxHeight - 2, tallestBuilding, config.columns, config.defender, endless, grid) == false){
+		stopRenderer(renderer);
+		closeDisplay();
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+		destroyRenderer(renderer);
+		destroyOccupancy(grid);
+		freeConfig(&config);
+		return EXIT_FAILURE;
+	}
+	game.renderer = renderer;
+	watchClock(game.clock);
 
-	shield = createShield((column / 2) + 3);
+	shield = createShield(&game, (config.columns / 2) + 3);
+	showShield(shield); // in place before any missile can fall, however fast the clock
 	pthread_t shieldThread;
+	long spacing = 1000000; // microseconds between launches
 	if (missileCount == 0){
-		missileCount = 20;
-		missiles = malloc(missileCount * sizeof(struct Missile_S));
-                threads = calloc(missileCount, sizeof(pthread_t));
-		for (size_t i = 0; i < missileCount; i++){
-			int x = rand() % (MIN((int)column, maxWidth) + 1);
-			missiles[i] = createMissile(x, delay);
-			delay += 1000000;
-		}
-		pthread_create(&shieldThread, NULL, &runShield, shield);
-		
-		while (attack == true){
-			if (threads != NULL)
-				free(threads);
-			threads = calloc(missileCount, sizeof(pthread_t));
-			restartAttack(missiles);
-			for (size_t i = 0; i < missileCount; i++)
-                       		pthread_create(&threads[i], NULL, &run, missiles[i]);
-                	for (size_t i = 0; i < missileCount; i++)
-				pthread_join(threads[i], NULL); // waits for threads to finish
-		}
-	} else {
-		missiles = malloc(missileCount * sizeof(struct Missile_S));
-		threads = calloc(missileCount, sizeof(pthread_t));
-		for (size_t i = 0; i < missileCount; i++){
-			int x = rand() % (MIN((int)column, maxWidth) + 1); // randomly generates the column for each missile
-			missiles[i] = createMissile(x, delay);
-			delay += 1000000; // figure out appropriate value
-		}
-
+		missileCount = density;
+		spacing = 1000000 / spawnRate;
+	}
+	if (replay != NULL)
+		missileCount = header.missiles;
+	missiles = createMissileStore(missileCount);
+	if (missiles == NULL){ // a count the config allows can still be more slots than memory holds
+		stopRenderer(renderer);
+		closeDisplay();
+		fprintf(stderr, "%s", "Error: out of memory.\n");
+		if (replay != NULL)
+			destroyReplay(replay);
+		if (shield != NULL)
+			destroyShield(shield);
+		watchClock(NULL);
+		releaseThreads(&game);
+		destroyRenderer(renderer);
+		destroyOccupancy(grid);
+		freeConfig(&config);
+		return EXIT_FAILURE;
+	}
+	if (autopilot == true){
+		pilot = createAutopilot(missileCount, worldWidth, AUTOPILOT_PERIOD);
+		if (pilot == NULL)
+			renderPrint(renderer, 1, 6, "%s", "Unable to create the autopilot; the shield is not steered.");
+		game.autopilot = pilot;
+	}
+	clockStart(game.clock, speed); // game time starts with the first launch
+	if (recordFile != NULL){
+		RecordHeader recorded = { seed, maxHeight, config.columns, missileCount, endless };
+		game.record = recordOpen(recordFile, &recorded, game.clock);
+		if (game.record == NULL)
+			renderPrint(renderer, 1, 6, "%s", "Unable to create the record log; not recording.");
+	}
+	if (mirrorName != NULL){
+		mirror = mirrorOpen(mirrorName, shield, missiles, config.heights, config.columns, maxHeight, worldWidth);
+		if (mirror == NULL)
+			renderPrint(renderer, 2, 6, "%s", "Unable to create the mirror; spectators cannot attach.");
+		else
+			renderMirror(renderer, mirror); // written by the render thread, once per frame
+	}
+	renderRepair(renderer, missiles); // redrawn from, should missile events be dropped
+	for (size_t i = 0; replay == NULL && i < missileCount; i++){
+		rngSeed(&stream, seed, i); // each missile draws from its own stream of the seed
+		int x = rngBelow(&stream, config.columns + 1); // randomly generates the column for each missile
+		createMissile(&game, missiles, x, delay, &stream);
+		delay += spacing;
+	}
+	pool = replay == NULL ? createPool(poolSize, missiles) : NULL;
+	bool stranded = replay == NULL && pool == NULL; // out of memory for the workers
+	if (stranded == true)
+		renderPrint(renderer, 3, 6, "%s", "Unable to start the missile workers; the attack is called off.");
+	else if (replay == NULL && pilot != NULL){
+		clockJoin(game.clock); // on the autopilot's behalf, before the clock can move
+		pthread_create(&shieldThread, NULL, &runAutopilot, shield);
+	} else if (replay == NULL)
 		pthread_create(&shieldThread, NULL, &runShield, shield);
+	if (replay != NULL){ // the log moves the missiles and the shield
+		mismatches = replayGame(replay, missiles, shield);
+		destroyReplay(replay);
+	} else if (stranded == true){
+		endGame(&game);
+	} else if (endless == true){
+		poolRespawn(pool, spacing); // each slot relaunches as soon as its missile explodes
 		for (size_t i = 0; i < missileCount; i++)
-			pthread_create(&threads[i], NULL, &run, missiles[i]);
+			poolSubmit(pool, &missiles->handles[i]);
+		poolWait(pool); // slots respawn forever, so this returns once the game is called off
+		endGame(&game);
+		pthread_join(shieldThread, NULL);
+	} else {
 		for (size_t i = 0; i < missileCount; i++)
-			pthread_join(threads[i], NULL); // waits for threads to finish
-		mvprintw(3,6, "The %s attack has ended.", attackForce);
-		refresh();
-		endGame(); // informs the shield that they attackers turn has ended
+			poolSubmit(pool, &missiles->handles[i]);
+		poolWait(pool); // waits for every missile to explode, or for the game to be called off
+		if (clockCancelled(game.clock) == false)
+			renderPrint(renderer, 3, 6, "The %s attack has ended.", config.attacker);
+		endGame(&game); // informs the shield that they attackers turn has ended
 		pthread_join(shieldThread, NULL); // waits for the shieldThread to finish
 	}
+	if (pool != NULL)
+		destroyPool(pool);
+	recordClose(game.record);
+	stopRenderer(renderer); // draws the last frame
+	mirrorClose(mirror); // spectators see the game end
 
-	for (size_t i = 0; i < missileCount; i++) // free all dynamically allocated memory for missile objects
-                        destroyMissile(missiles[i]);
+	destroyMissileStore(missiles); // frees every missile at once
 	if (shield != NULL)
 		destroyShield(shield);
-	if (missiles != NULL)
-		free(missiles);
-	if (threads != NULL)
-		free(threads);
-	if (attackForce != NULL)
-		free(attackForce);
-	if (defenseForce != NULL)
-		free(defenseForce);
-	if (heights != NULL)
-		free(heights);
+	freeConfig(&config);
+	pthread_cancel(signalThread); // sigwait is a cancellation point
+	pthread_join(signalThread, NULL); // nothing cancels the clock once it is gone
+	releaseThreads(&game);
+	destroyOccupancy(grid);
 
-	endwin(); // terminates the curses environment
-	return 0;
+	if (headless == true)
+		displayDump(stdout); // the final frame, for comparing runs
+	closeDisplay(); // terminates the curses environment
+	int signal = __atomic_load_n(&caught, __ATOMIC_ACQUIRE);
+	if (signal != 0)
+		fprintf(stderr, "stopped by signal %d\n", signal);
+	fprintf(stderr, "seed: %" PRIu64 "\n", seed);
+	if (pilot != NULL){ // the block rate the autopilot achieved
+		size_t exploded = 0;
+		for (int kind = 0; kind < HIT_KINDS; kind++)
+			exploded += game.hits[kind];
+		fprintf(stderr, "autopilot: %zu of %zu missiles blocked (%.1f%%), %zu conceded\n",
+				game.hits[HIT_SHIELD], exploded, exploded > 0 ? 100.0 * game.hits[HIT_SHIELD] / exploded : 0.0,
+				autopilotConceded(pilot));
+		destroyAutopilot(pilot);
+	}
+	statsWrite(stderr, false); // lock contention and hot-path counters
+	renderStats(renderer, &events); // reports how the event ring coped, for sizing -q
+	fprintf(stderr, "events: %zu published, high water %zu of %zu slots, %zu stalls, %zu dropped\n",
+			events.published, events.highWater, events.capacity, events.stalls, events.dropped);
+	destroyRenderer(renderer);
+	if (signal != 0)
+		return 128 + signal; // the shell's convention for a process a signal ended
+	return mismatches == 0 && stranded == false ? 0 : EXIT_FAILURE;
 }
 
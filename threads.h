@@ -5,15 +5,66 @@
 /// 
 /// This is the interface for the threads game. 
 /// Contains the interfaces for the defense shield, and missile threads.
+///
+/// Every piece of game state lives in a Game, its clock, renderer and
+/// record log included, so any number of games can run in one process.
+/// Only the terminal display, which one renderer draws on at a time, and
+/// the instrumentation, which sums every game, are one per process.
 
 #ifndef _THREADS_H
 #define _THREADS_H
 #include <stdbool.h>
+#include "occupancy.h"
+#include "rng.h"
+#include "plock.h"
+#include "autopilot.h"
+#include "clock.h"
+#include "record.h"
+
+/// Game_S structure holds the state of one game, shared by its shield,
+/// its missiles and the workers advancing them. It is filled in by
+/// initThreads and the caller owns its storage.
+
+typedef struct Game_S {
+
+    int ground; ///< the ground row / highest possible missile row
+
+    int height; ///< the shield's row
+
+    int columns; ///< the maximum column a missile launches down
+
+    bool attacking; ///< whether the attack is still going on, read and written atomically
+
+    bool quit; ///< whether the defender has asked to quit, read and written atomically
+
+    bool endless; ///< whether the attacker has unlimited missiles
+
+    char *defenseForce; ///< the name of the defender
+
+    Occupancy *grid; ///< what fills each cell, for collision detection
+
+    PriorityLock *stripes; ///< one lock per stripe of columns; the shield acquires with priority
+
+    int stripeCount; ///< number of stripes
+
+    size_t hits[HIT_KINDS]; ///< explosions so far, by what each missile struck
+
+    Autopilot *autopilot; ///< indexes the falling missiles for an autopilot shield, NULL when a player steers
+
+    Clock *clock; ///< the game's time, which every thread of the game sleeps on
+
+    struct Renderer_S *renderer; ///< draws the game, NULL when it is not drawn
+
+    Recorder *record; ///< logs the game for replay, NULL when it is not recorded
+
+} Game;
 
 /// Shield_S structure represents a missile's row, column and display graphic.
 
 typedef struct Shield_S {
 
+    Game *game; ///< the game the shield defends
+
     int row;       ///< vertical row of the shield
 
     int column;  ///< left-most column of the shield
@@ -24,19 +75,39 @@ typedef struct Shield_S {
 
 /// initThreads does setup work for the defense shield before the start of the game
 ///
+/// @param game the game being set up
 /// @param groundHeight the height of the ground / highest possible missile row 
 /// @param buildingHeight the height of the highest building in the city
 /// @param maxColumn the maximum column value displayed in the curses environment
 /// @param defense the name of the defender
 /// @param endlessAttack whether the attacker has infinite number of missiles
+/// @param occupancy the collision grid holding the city
+/// @return true if the stripe locks and the clock could be allocated
+
+bool initThreads( Game *game, int groundHeight, int buildingHeight, int maxColumn, char * defense, bool endlessAttack, Occupancy * occupancy);
 
-void initThreads( int groundHeight, int buildingHeight, int maxColumn, char * defense, bool endlessAttack);
+/// releaseThreads - Frees what initThreads allocated, once no thread uses it.
+///
+/// @param game the game being released
+
+void releaseThreads( Game *game );
+
+/// columnStripe - Finds the stripe of columns a column belongs to. Missiles
+/// in different stripes never share a lock; only the shield spans stripes.
+///
+/// @param game the game the column is in
+/// @param column a column of the world
+/// @return the stripe's index, counted from 0
+
+int columnStripe( const Game *game, int column );
 
 /// createShield- Create a new shield.
 ///
+/// @param game the game the shield defends
+/// @param column the shield's left-most column
 /// @return Shield pointer to a dynamically allocated Shield object
 
-Shield * createShield( int column );
+Shield * createShield( Game *game, int column );
 
 /// destroyShield - Destroy all dynamically allocated storage for a shield.
 ///
@@ -52,45 +123,146 @@ void destroyShield( Shield *shield );
 
 void *runShield( void *shield );
 
-/// endGame - Informs the shield Thread that the game has ended
+/// runAutopilot - The 'main method' for a shield thread steered by the
+/// game's autopilot instead of the keyboard, one move every AUTOPILOT_PERIOD.
+///
+/// @param shield Shield object declared as void* for pthread operability
+/// @return void pointer to status. A NULL represents success.
+/// @pre the game has an autopilot, and the caller has joined the clock on
+///      the thread's behalf.
+
+void *runAutopilot( void *shield );
 
-void endGame();
+/// showShield - Puts the shield in the collision grid and on the display.
+///
+/// @param shield the shield being shown
 
-/// Missile_S structure represents a missile's row, column and display graphic.
+void showShield( Shield *shield );
 
-typedef struct Missile_S {
+/// advanceShield - Moves the shield one column, ahead of every missile.
+///
+/// @param shield the shield being moved
+/// @param left true to move left, false to move right
+/// @param stamp when the key asking for the move was read, 0 if none
+
+void advanceShield( Shield *shield, bool left, uint64_t stamp );
+
+/// endGame - Informs the shield Thread that the game has ended, waking it
+/// if it is asleep on the clock
+///
+/// @param game the game whose attack is over
+
+void endGame( Game *game );
 
-    int height;       ///< vertical row of a missile
+/// MISSILE_GRAPHIC is the character every falling missile is drawn with
 
-    int column;  ///< column of the missile
+#define MISSILE_GRAPHIC '|'
 
-    char graphic; ///< graphic is the character representation of the missile
+/// LAUNCH_ROW is the row a missile waits on, undrawn, before its first step
 
-    int delay; /// delay is the amount of time the missile waits before starting to fall
+#define LAUNCH_ROW 6
+
+/// MissileStore_S structure holds every missile's state in one pooled
+/// allocation, laid out as a separate array per field. Slot i of every
+/// array belongs to the same missile.
+
+typedef struct MissileStore_S {
+
+    Game *game; ///< the game every missile in the store attacks
+
+    size_t capacity; ///< number of missile slots
+
+    size_t count; ///< slots handed out by createMissile
+
+    int *height; ///< vertical row of each missile
+
+    int *column; ///< column of each missile
+
+    int *delay; ///< time each missile waits before starting to fall
+
+    bool *exploded; ///< whether each missile has stopped falling
+
+    Rng *rng; ///< each missile's own random stream, for its columns and fall timings
+
+    struct Missile_S *handles; ///< the handle for each slot
+
+} MissileStore;
+
+/// Missile_S structure is a handle naming one slot of a MissileStore.
+
+typedef struct Missile_S {
+
+    MissileStore *store; ///< the store holding the missile's state
+
+    size_t id; ///< the missile's slot in the store
 
-    bool exploded; /// exploded whether the missile is still falling
 } Missile;
 
-/// createMissile- Create a new missile.
+/// createMissileStore - Create a store with room for a number of missiles.
 ///
-/// @param column the column value for the missile
-/// @param delay the amount of time the missile waits before starting to fall
-/// @return Missile pointer to a dynamically allocated Missile object
+/// @param capacity the number of missile slots
+/// @return MissileStore pointer to a dynamically allocated MissileStore object
 
-Missile * createMissile( int column , int delay);
+MissileStore * createMissileStore( size_t capacity );
 
-/// destroyMissile - Destroy all dynamically allocated storage for a missile.
+/// destroyMissileStore - Destroy all dynamically allocated storage for a store
+/// and every missile in it.
 ///
-/// @param missile the object to be de-allocated
+/// @param store the object to be de-allocated
 
-void destroyMissile( Missile *missile );
+void destroyMissileStore( MissileStore *store );
 
-/// resetMissile - Prepares a Missile object for reuse
+/// createMissile- Create a new missile in the next free slot of a store.
+///
+/// @param game the game the missile attacks, the same for every missile of a store
+/// @param store the store holding the missile
+/// @param column the column value for the missile
+/// @param delay the amount of time the missile waits before starting to fall
+/// @param stream the random stream the missile continues drawing from
+/// @return Missile handle for the slot, or NULL when the store is full
+
+Missile * createMissile( Game *game, MissileStore *store, int column , int delay, const Rng *stream);
+
+/// resetMissile - Prepares a Missile slot for reuse
 //
-// @param missile pointer to the missile object being reused
+// @param missile handle of the missile being reused
 
 void resetMissile(Missile * missile);
 
+/// advance - Moves a missile one row down and handles whatever it hits.
+///
+/// @param missile the missile being advanced
+/// @param now the game time in microseconds of the step, from which the
+///        autopilot predicts when the missile reaches the shield
+/// @pre missile cannot be NULL.
+
+void advance( Missile *missile, uint64_t now );
+
+/// advanceBatch - Moves a batch of missiles one row down, with the same
+/// outcome as calling advance on each in turn. The steps are worked out
+/// BATCH_SIZE missiles at a time by the vector kernel in batch.c.
+///
+/// @param store the store holding the missiles
+/// @param ids the slots of the missiles, each still falling
+/// @param count number of missiles in the batch
+/// @param now the game time in microseconds of the step
+
+void advanceBatch( MissileStore *store, const size_t *ids, size_t count, uint64_t now );
+
+/// nextFallDelay - Picks the time a missile waits before its next row.
+///
+/// @param missile the falling missile
+/// @return the delay in microseconds
+
+long nextFallDelay( Missile *missile );
+
+/// gameLockStats - Adds up how long threads have waited for and held the stripe locks.
+///
+/// @param game the game whose locks are read
+/// @param stats where the timings are stored
+
+void gameLockStats( Game *game, PriorityLockStats *stats );
+
 /// This function is the 'main method' for a missile thread instance.
 ///
 /// @param missile Missile  object declared as void* for pthread operability
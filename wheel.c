@@ -0,0 +1,215 @@
+/// Program: wheel.c
+///------------------
+/// Hierarchical timing wheel. Level 0 has one slot per tick; each higher
+/// level has one slot per full turn of the level below it, and its timers
+/// are moved down a level when the wheel reaches their slot.
+///
+/// @author Brennan Reed
+
+#include "wheel.h"
+#include <stdlib.h>
+#include <assert.h>
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+/// Function: append
+///------------------
+/// Adds an id to the end of a list
+///
+/// @param wheel the wheel the list is linked through
+/// @param list the list being added to
+/// @param id the id being added
+
+static void append(TimingWheel * wheel, TimerList * list, int32_t id){
+	wheel->next[id] = TIMER_NONE;
+	if (list->tail == TIMER_NONE)
+		list->head = id;
+	else
+		wheel->next[list->tail] = id;
+	list->tail = id;
+	list->count++;
+}
+
+/// Function: splice
+///------------------
+/// Moves every id of one list onto the end of another
+///
+/// @param wheel the wheel the lists are linked through
+/// @param to the list being added to
+/// @param from the list being emptied
+
+static void splice(TimingWheel * wheel, TimerList * to, TimerList * from){
+	if (from->head == TIMER_NONE)
+		return;
+	if (to->tail == TIMER_NONE)
+		to->head = from->head;
+	else
+		wheel->next[to->tail] = from->head;
+	to->tail = from->tail;
+	to->count += from->count;
+	from->head = from->tail = TIMER_NONE;
+	from->count = 0;
+}
+
+/// Function: place
+///-----------------
+/// Puts a pending id in the slot of the lowest level whose span covers it
+///
+/// @param wheel the wheel being updated
+/// @param id the id being placed
+
+static void place(TimingWheel * wheel, int32_t id){
+	uint64_t expires = wheel->expires[id];
+	if (expires <= wheel->now){
+		append(wheel, &wheel->overdue, id);
+		return;
+	}
+	uint64_t delta = expires - wheel->now;
+	int level = 0;
+	while (level < WHEEL_LEVELS - 1 && delta >= (uint64_t)1 << (WHEEL_BITS * (level + 1)))
+		level++;
+	uint64_t span = (uint64_t)1 << (WHEEL_BITS * (level + 1));
+	if (delta >= span) // beyond the top level, waits in its furthest slot
+		expires = wheel->now + span - 1;
+	append(wheel, &wheel->slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK], id);
+}
+
+/// Function: createWheel
+///-----------------------
+/// Creates an empty wheel for ids 0 to capacity - 1
+///
+/// @param capacity the number of ids
+/// @param start the tick the wheel starts at
+/// @return TimingWheel pointer to the dynamically allocated wheel object
+
+TimingWheel * createWheel(size_t capacity, uint64_t start){
+	TimingWheel * new = malloc(sizeof(struct TimingWheel_S));
+	if (new == NULL)
+		return NULL;
+	new->next = malloc(capacity * sizeof(int32_t));
+	new->expires = malloc(capacity * sizeof(uint64_t));
+	if (new->next == NULL || new->expires == NULL){
+		free(new->next);
+		free(new->expires);
+		free(new);
+		return NULL;
+	}
+	new->now = start;
+	new->pending = 0;
+	for (int level = 0; level < WHEEL_LEVELS; level++){
+		for (int slot = 0; slot < WHEEL_SLOTS; slot++){
+			new->slots[level][slot].head = new->slots[level][slot].tail = TIMER_NONE;
+			new->slots[level][slot].count = 0;
+		}
+	}
+	new->overdue.head = new->overdue.tail = TIMER_NONE;
+	new->overdue.count = 0;
+	return new;
+}
+
+/// Function: destroyWheel
+///------------------------
+/// De-allocates all dynamic memory for a wheel
+///
+/// @param wheel pointer to the wheel being freed
+
+void destroyWheel(TimingWheel * wheel){
+	assert(wheel != NULL);
+	free(wheel->next);
+	free(wheel->expires);
+	free(wheel);
+}
+
+/// Function: wheelSchedule
+///-------------------------
+/// Schedules an id to expire on a tick
+///
+/// @param wheel the wheel scheduled on
+/// @param id the timer id
+/// @param expires the tick to expire on
+
+void wheelSchedule(TimingWheel * wheel, int32_t id, uint64_t expires){
+	assert(wheel != NULL && id >= 0);
+	wheel->expires[id] = expires;
+	wheel->pending++;
+	place(wheel, id);
+}
+
+/// Function: wheelAdvance
+///------------------------
+/// Moves the wheel forward one tick at a time. Whenever level 0 completes a
+/// turn, the next slot of each higher level is redistributed downwards
+/// before level 0's slot for the tick is collected.
+///
+/// @param wheel the wheel being advanced
+/// @param tick the tick to advance to
+/// @param expired list the expired ids are appended to
+
+void wheelAdvance(TimingWheel * wheel, uint64_t tick, TimerList * expired){
+	assert(wheel != NULL && expired != NULL);
+	wheel->pending -= wheel->overdue.count;
+	splice(wheel, expired, &wheel->overdue);
+	while (wheel->now < tick && wheel->pending > 0){
+		wheel->now++;
+		for (int level = 1; level < WHEEL_LEVELS; level++){
+			if ((wheel->now & (((uint64_t)1 << (WHEEL_BITS * level)) - 1)) != 0)
+				break; // the level below hasn't completed a turn
+			TimerList * slot = &wheel->slots[level][(wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+			int32_t id = slot->head;
+			slot->head = slot->tail = TIMER_NONE;
+			slot->count = 0;
+			while (id != TIMER_NONE){ // moves each timer to a lower level
+				int32_t following = wheel->next[id];
+				place(wheel, id);
+				id = following;
+			}
+		}
+		TimerList * due = &wheel->slots[0][wheel->now & WHEEL_MASK];
+		wheel->pending -= due->count;
+		splice(wheel, expired, due);
+		wheel->pending -= wheel->overdue.count; // timers pulled down to this very tick
+		splice(wheel, expired, &wheel->overdue);
+	}
+	if (wheel->now < tick)
+		wheel->now = tick; // nothing is pending, skips straight there
+}
+
+/// Function: wheelNextExpiry
+///---------------------------
+/// Finds the earliest tick worth advancing the wheel to
+///
+/// @param wheel the wheel being queried
+/// @return the first tick that expires a timer or moves timers down from a
+///         higher level, or UINT64_MAX if no timer is pending
+
+uint64_t wheelNextExpiry(const TimingWheel * wheel){
+	if (wheel->overdue.count > 0)
+		return wheel->now;
+	if (wheel->pending == 0)
+		return UINT64_MAX;
+	uint64_t turn = (wheel->now | WHEEL_MASK) + 1; // where level 0 completes its turn
+	for (uint64_t tick = wheel->now + 1; tick < turn; tick++){
+		if (wheel->slots[0][tick & WHEEL_MASK].count > 0)
+			return tick;
+	}
+	return turn;
+}
+
+/// Function: timerListPop
+///------------------------
+/// Removes the first id from a list
+///
+/// @param wheel the wheel the list is linked through
+/// @param list the list being taken from
+/// @return the id, or TIMER_NONE if the list is empty
+
+int32_t timerListPop(TimingWheel * wheel, TimerList * list){
+	int32_t id = list->head;
+	if (id == TIMER_NONE)
+		return TIMER_NONE;
+	list->head = wheel->next[id];
+	if (list->head == TIMER_NONE)
+		list->tail = TIMER_NONE;
+	list->count--;
+	return id;
+}
@@ -0,0 +1,113 @@
+/// wheel.h - header file for the hierarchical timing wheel
+///
+/// @author Brennan Reed
+///
+/// This is the interface for the timing wheel that schedules missile steps.
+/// Timers are named by small integer ids, one per missile slot, and are
+/// linked through arrays owned by the wheel, so scheduling never allocates.
+
+#ifndef _WHEEL_H
+#define _WHEEL_H
+#include <stddef.h>
+#include <stdint.h>
+
+/// TICK_US is the length of one wheel tick in microseconds
+
+#define TICK_US 1000
+
+/// WHEEL_BITS is log2 of the number of slots on each level
+
+#define WHEEL_BITS 6
+
+/// WHEEL_SLOTS is the number of slots on each level
+
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+
+/// WHEEL_LEVELS is the number of levels; together they span
+/// WHEEL_SLOTS ^ WHEEL_LEVELS ticks, longer timers wait on the last level
+
+#define WHEEL_LEVELS 4
+
+/// TIMER_NONE marks the end of a list of timers
+
+#define TIMER_NONE (-1)
+
+/// TimerList_S structure is a first-in, first-out list of timer ids
+
+typedef struct TimerList_S {
+
+    int32_t head; ///< first id in the list, or TIMER_NONE
+
+    int32_t tail; ///< last id in the list, or TIMER_NONE
+
+    size_t count; ///< number of ids in the list
+
+} TimerList;
+
+/// TimingWheel_S structure holds every pending timer
+
+typedef struct TimingWheel_S {
+
+    uint64_t now; ///< the last tick the wheel was advanced to
+
+    size_t pending; ///< number of timers scheduled and not yet expired
+
+    int32_t *next; ///< link to the following id of whichever list an id is on
+
+    uint64_t *expires; ///< tick each id expires on
+
+    TimerList slots[WHEEL_LEVELS][WHEEL_SLOTS]; ///< the wheel's levels
+
+    TimerList overdue; ///< timers scheduled for a tick that has already passed
+
+} TimingWheel;
+
+/// createWheel - Create an empty wheel for ids 0 to capacity - 1.
+///
+/// @param capacity the number of ids
+/// @param start the tick the wheel starts at
+/// @return TimingWheel pointer to a dynamically allocated TimingWheel object
+
+TimingWheel * createWheel( size_t capacity, uint64_t start );
+
+/// destroyWheel - Destroy all dynamically allocated storage for a wheel.
+///
+/// @param wheel the object to be de-allocated
+
+void destroyWheel( TimingWheel *wheel );
+
+/// wheelSchedule - Schedules an id to expire on a tick.
+///
+/// @param wheel the wheel scheduled on
+/// @param id the timer id, which must not already be scheduled
+/// @param expires the tick to expire on, the next advance if already passed
+
+void wheelSchedule( TimingWheel *wheel, int32_t id, uint64_t expires );
+
+/// wheelAdvance - Moves the wheel forward and collects what expired.
+///
+/// @param wheel the wheel being advanced
+/// @param tick the tick to advance to
+/// @param expired list the expired ids are appended to in expiry order;
+///        it is linked through the wheel, so an id must leave it before
+///        being scheduled again
+
+void wheelAdvance( TimingWheel *wheel, uint64_t tick, TimerList *expired );
+
+/// wheelNextExpiry - The earliest tick worth advancing the wheel to.
+///
+/// @param wheel the wheel being queried
+/// @return the first tick that expires a timer or moves timers down from a
+///         higher level, or UINT64_MAX if no timer is pending
+
+uint64_t wheelNextExpiry( const TimingWheel *wheel );
+
+/// timerListPop - Removes the first id from a list.
+///
+/// @param wheel the wheel the list is linked through
+/// @param list the list being taken from
+/// @return the id, or TIMER_NONE if the list is empty
+
+int32_t timerListPop( TimingWheel *wheel, TimerList *list );
+
+#endif